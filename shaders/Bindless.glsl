@@ -0,0 +1,22 @@
+#ifndef BINDLESS_GLSL
+#define BINDLESS_GLSL
+#extension GL_EXT_nonuniform_qualifier : require
+
+// BindlessHeap, bound as set 1 when the engine runs with --bindless. Indices come from
+// Buffer::getBindlessIndex() and Texture::getBindlessSampledIndex()/getBindlessStorageIndex(),
+// wrap them in nonuniformEXT() when they differ within a subgroup.
+#define BINDLESS_SET 1
+#define BINDLESS_INVALID_INDEX 0xffffffffu
+
+layout(std430,set=BINDLESS_SET,binding=0)buffer FBindlessBuffer{
+    uint mData[];
+}BindlessBuffers[];
+
+layout(set=BINDLESS_SET,binding=1)uniform texture2D BindlessTextures[];
+
+// every storage image the renderer writes is rgba32f
+layout(set=BINDLESS_SET,binding=2,rgba32f)uniform image2D BindlessImages[];
+
+layout(set=BINDLESS_SET,binding=3)uniform sampler BindlessSamplers[];
+
+#endif // BINDLESS_GLSL
@@ -1,5 +1,5 @@
 #version 450
-layout(local_size_x=1,local_size_y=1,local_size_z=1)in;
+layout(local_size_x=64,local_size_y=1,local_size_z=1)in;
 #define NANITE_MAX_GROUP_PARTS_BITS							5
 #define NANITE_MAX_GROUP_PARTS_MASK							((1 << NANITE_MAX_GROUP_PARTS_BITS) - 1)
 #define NANITE_MAX_GROUP_PARTS								(1 << NANITE_MAX_GROUP_PARTS_BITS)
@@ -13,23 +13,45 @@ layout(local_size_x=1,local_size_y=1,local_size_z=1)in;
 #define NANITE_MAX_BVH_NODE_FANOUT							(1 << NANITE_MAX_BVH_NODE_FANOUT_BITS)
 #define HIERARCHY_NODE_SLICE_SIZE	((4 + 4 + 4 + 1) * 4 * NANITE_MAX_BVH_NODE_FANOUT)
 
-layout(binding=0)uniform GlobalConstants {
-	mat4 mProjectionMatrix;
-	mat4 mViewMatrix;//View => translate
-	mat4 mModelMatrix;
-	uvec4 mMisc0;//0xFFFFFFFFu
-	vec4 mNanite_ViewOrigin;//x,y,z,w => lodScale
-	vec4 mNanite_ViewForward;//x,y,z,w => lodScaleHW
-};
+#ifndef CULLING_PASS
+#define CULLING_PASS				0
+#endif
+#define CULLING_PASS_MAIN			0//tests against last frame's HZB,occluded clusters are deferred to the post pass
+#define CULLING_PASS_POST			1//re-tests the deferred clusters against the HZB of this frame's main pass
+
+#define CLUSTER_CULL_GROUP_SIZE		64u
+#define MAX_CANDIDATE_NODES			1024u
+#define CANDIDATE_CLUSTERS_OFFSET	(MAX_CANDIDATE_NODES*2u)
+
+#define GLOBAL_CONSTANTS_BINDING	0
+#define HZB_BINDING					6
+#include "Culling.glsl"
 layout(std430,binding=1)buffer FMainAndPostNodeAndClusterBatches{
     uint mData[];
 }MainAndPostNodeAndClusterBatches;//21
-layout(std430,binding=2)buffer FVisibleClusterSHWH{
-    uint mData[];
+//x => absolute index data offset,y => absolute position data offset,z => index count,w => packed visibility id
+//HW raster clusters fill the first half,SW raster clusters the second one
+layout(std430,binding=2)writeonly buffer FVisibleClusterSHWH{
+    uvec4 mData[];
 }VisibleClusterSHWH;
-layout(std430,binding=3)buffer FWorkArgs0{
+//0 => HW visible cluster count(draw count),1..3 => SW raster dispatch args(x => SW visible cluster count)
+//4 => candidate cluster count,5..7 => dispatch args of this pass
+layout(std430,binding=3)buffer FClusterWorkArgs{
+    uint mData[];
+}ClusterWorkArgs;
+layout(std430,binding=4)readonly buffer FClusterPageData{
     uint mData[];
-}WorkArgs0;
+}ClusterPageData;
+//one VkDrawIndirectCommand per visible cluster,firstInstance => index into VisibleClusterSHWH
+layout(std430,binding=5)writeonly buffer FVisibleClusterDrawArgs{
+    uvec4 mData[];
+}VisibleClusterDrawArgs;
+#if CULLING_PASS==CULLING_PASS_MAIN
+//ClusterWorkArgs of the post pass,clusters occluded in last frame's HZB are appended to its candidates
+layout(std430,binding=7)buffer FPostClusterWorkArgs{
+    uint mData[];
+}PostClusterWorkArgs;
+#endif
 uint BitFieldExtractU32(uint Data, uint Size, uint Offset)
 {
 	// Shift amounts are implicitly &31 in HLSL, so they should be optimized away on most platforms
@@ -38,9 +60,132 @@ uint BitFieldExtractU32(uint Data, uint Size, uint Offset)
 	Offset &= 31;
 	return (Data >> Offset) & ((1u << Size) - 1u);
 }
-void main(){//
-	for(int i=0;i<932;i++){
-		VisibleClusterSHWH.mData[i*2]=MainAndPostNodeAndClusterBatches.mData[1024+i*2];
-		VisibleClusterSHWH.mData[i*2+1]=MainAndPostNodeAndClusterBatches.mData[1024+i*2+1];
+struct ClusterInfo{
+	uint mBaseOffset;
+	uint mIndexOffsetLocal;
+	uint mIndexCount;
+	vec4 mLODBounds;
+	float mLODError;
+	float mEdgeLength;
+};
+ClusterInfo GetClusterInfo(uint inPageIndex,uint inClusterIndex){
+	uint pageBaseOffset=ClusterPageData.mData[1u+inPageIndex]/4;
+	uint clusterCountOnPage=ClusterPageData.mData[pageBaseOffset];
+	uint clusterBaseOffsetInBytesLocal=ClusterPageData.mData[pageBaseOffset+1u+inClusterIndex];
+	uint clusterBaseOffset=pageBaseOffset+1u+clusterCountOnPage+clusterBaseOffsetInBytesLocal/4;
+	ClusterInfo clusterInfo;
+	clusterInfo.mBaseOffset=clusterBaseOffset;
+	clusterInfo.mIndexOffsetLocal=ClusterPageData.mData[clusterBaseOffset]/4;
+	clusterInfo.mIndexCount=ClusterPageData.mData[clusterBaseOffset+1u];
+	clusterInfo.mLODBounds=uintBitsToFloat(uvec4(
+		ClusterPageData.mData[clusterBaseOffset+2u],
+		ClusterPageData.mData[clusterBaseOffset+3u],
+		ClusterPageData.mData[clusterBaseOffset+4u],
+		ClusterPageData.mData[clusterBaseOffset+5u]
+	));
+	vec2 lodErrorAndEdgeLength=unpackHalf2x16(ClusterPageData.mData[clusterBaseOffset+6u]);
+	clusterInfo.mLODError=lodErrorAndEdgeLength.x;
+	clusterInfo.mEdgeLength=lodErrorAndEdgeLength.y;
+	return clusterInfo;
+}
+//same planes as NodeAndClusterCull,normalized here for the sphere test
+void GetFrustumPlanes(out vec4 outPlanes[6]){
+	mat4 viewProjection=U_GlobalConstants.mProjectionMatrix*U_GlobalConstants.mViewMatrix;
+	vec4 row0=vec4(viewProjection[0][0],viewProjection[1][0],viewProjection[2][0],viewProjection[3][0]);
+	vec4 row1=vec4(viewProjection[0][1],viewProjection[1][1],viewProjection[2][1],viewProjection[3][1]);
+	vec4 row2=vec4(viewProjection[0][2],viewProjection[1][2],viewProjection[2][2],viewProjection[3][2]);
+	vec4 row3=vec4(viewProjection[0][3],viewProjection[1][3],viewProjection[2][3],viewProjection[3][3]);
+	outPlanes[0]=row3+row0;
+	outPlanes[1]=row3-row0;
+	outPlanes[2]=row3+row1;
+	outPlanes[3]=row3-row1;
+	outPlanes[4]=row3+row2;
+	outPlanes[5]=row3-row2;
+	for(int i=0;i<6;i++){
+		float len=length(outPlanes[i].xyz);
+		outPlanes[i]=len>0.0f?outPlanes[i]/len:vec4(0.0f,0.0f,0.0f,1.0f);
+	}
+}
+bool IsSphereInFrustum(vec4 inSphere){
+	vec3 center=(U_GlobalConstants.mModelMatrix*vec4(inSphere.xyz,1.0f)).xyz-U_GlobalConstants.mNanite_ViewOrigin.xyz;
+	float radius=inSphere.w*GetMaxModelScale();
+	vec4 planes[6];
+	GetFrustumPlanes(planes);
+	for(int i=0;i<6;i++){
+		if(dot(planes[i].xyz,center)+planes[i].w<-radius){
+			return false;
+		}
+	}
+	return true;
+}
+//one invocation per candidate cluster,survivors are appended in any order
+void main(){
+	//main and post candidate lists split the buffer behind the node lists
+	uint maxCandidateClusters=(uint(MainAndPostNodeAndClusterBatches.mData.length())-CANDIDATE_CLUSTERS_OFFSET)/4;
+	uint candidateClustersOffset=CANDIDATE_CLUSTERS_OFFSET+uint(CULLING_PASS)*maxCandidateClusters*2u;
+	uint candidateClusterCount=min(ClusterWorkArgs.mData[4],maxCandidateClusters);
+	uint candidateIndex=gl_GlobalInvocationID.x;
+	if(candidateIndex>=candidateClusterCount){
+		return;
+	}
+	uint pageIndex=MainAndPostNodeAndClusterBatches.mData[candidateClustersOffset+candidateIndex*2];
+	uint clusterIndexOnPage=MainAndPostNodeAndClusterBatches.mData[candidateClustersOffset+candidateIndex*2+1];
+	ClusterInfo clusterInfo=GetClusterInfo(pageIndex,clusterIndexOnPage);
+	if(!IsSphereInFrustum(clusterInfo.mLODBounds)){
+		return;
+	}
+	vec3 boundsExtent=vec3(clusterInfo.mLODBounds.w);
+#if CULLING_PASS==CULLING_PASS_MAIN
+	if(IsPrevHZBValid()&&IsBoxOccluded(clusterInfo.mLODBounds.xyz,boundsExtent,true)){
+		//hidden last frame,the post pass re-tests it against this frame's HZB
+		uint postCandidateIndex=atomicAdd(PostClusterWorkArgs.mData[4],1u);
+		if(postCandidateIndex<maxCandidateClusters){
+			uint postCandidateClustersOffset=CANDIDATE_CLUSTERS_OFFSET+maxCandidateClusters*2u;
+			MainAndPostNodeAndClusterBatches.mData[postCandidateClustersOffset+postCandidateIndex*2]=pageIndex;
+			MainAndPostNodeAndClusterBatches.mData[postCandidateClustersOffset+postCandidateIndex*2+1]=clusterIndexOnPage;
+			atomicMax(PostClusterWorkArgs.mData[5],(postCandidateIndex+CLUSTER_CULL_GROUP_SIZE)/CLUSTER_CULL_GROUP_SIZE);
+		}
+		return;
 	}
-}
\ No newline at end of file
+#else
+	if(IsBoxOccluded(clusterInfo.mLODBounds.xyz,boundsExtent,false)){
+		return;
+	}
+#endif
+	//resolve the page table once here instead of per vertex in the raster passes
+	uvec4 visibleCluster=uvec4(
+		clusterInfo.mBaseOffset+clusterInfo.mIndexOffsetLocal,
+		clusterInfo.mBaseOffset+7u,
+		clusterInfo.mIndexCount,
+		(pageIndex<<8) | (clusterIndexOnPage+1u)
+	);
+	uint maxVisibleClusters=uint(VisibleClusterSHWH.mData.length())/2u;
+
+	//edges projecting below the HW threshold go to the compute rasterizer,
+	//clusters reaching the near plane stay on HW raster which clips them
+	vec3 center=(U_GlobalConstants.mModelMatrix*vec4(clusterInfo.mLODBounds.xyz,1.0f)).xyz-U_GlobalConstants.mNanite_ViewOrigin.xyz;
+	float radius=clusterInfo.mLODBounds.w*GetMaxModelScale();
+	bool bCrossesNearPlane=dot(U_GlobalConstants.mNanite_ViewForward.xyz,center)-radius<=U_GlobalConstants.mNanite_ViewParams.x;
+	float projectedEdgeScale=GetProjectedEdgeScales(clusterInfo.mLODBounds).x;
+	bool bUseHWRaster=bCrossesNearPlane||projectedEdgeScale<U_GlobalConstants.mNanite_ViewForward.w*GetMaxModelScale()*abs(clusterInfo.mEdgeLength);
+	if(bUseHWRaster){
+		//the visible count is the draw count of the hw raster pass
+		uint visibleIndex=atomicAdd(ClusterWorkArgs.mData[0],1u);
+		if(visibleIndex<maxVisibleClusters){
+			VisibleClusterSHWH.mData[visibleIndex]=visibleCluster;
+			//exact index count,no degenerate vertices for small clusters
+			VisibleClusterDrawArgs.mData[visibleIndex]=uvec4(clusterInfo.mIndexCount,1u,0u,visibleIndex);
+		}
+	}else{
+		//one SW raster group per cluster,the count is the group count of its dispatch.
+		//65535 is all maxComputeWorkGroupCount[0] guarantees,every add past it is taken back
+		//by the same invocation so the count ends up clamped
+		uint maxSWRasterClusters=min(maxVisibleClusters,65535u);
+		uint visibleIndex=atomicAdd(ClusterWorkArgs.mData[1],1u);
+		if(visibleIndex>=maxSWRasterClusters){
+			atomicMin(ClusterWorkArgs.mData[1],maxSWRasterClusters);
+		}else{
+			VisibleClusterSHWH.mData[maxVisibleClusters+visibleIndex]=visibleCluster;
+		}
+	}
+}
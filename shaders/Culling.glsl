@@ -0,0 +1,107 @@
+#ifndef CULLING_GLSL
+#define CULLING_GLSL
+#include "HZB.glsl"
+
+// Shared by NodeAndClusterCull and ClusterCull, which bind the constants and the HZB at different slots. Define
+// GLOBAL_CONSTANTS_BINDING and HZB_BINDING before including.
+layout(binding=GLOBAL_CONSTANTS_BINDING)uniform GlobalConstants {
+	mat4 mProjectionMatrix;
+	mat4 mViewMatrix;//View => translate
+	mat4 mModelMatrix;
+	uvec4 mMisc0;//0xFFFFFFFFu,x:Manual MipLevel,y:bit 0 => last frame's HZB is valid
+	vec4 mNanite_ViewOrigin;//x,y,z,w => lodScale
+	vec4 mNanite_ViewForward;//x,y,z,w => lodScaleHW,view to pixels over the min. edge length in pixels of HW raster
+	vec4 mNanite_ViewParams;//x => near plane,y => viewport width,z => viewport height
+	mat4 mPrevTranslatedViewProjectionMatrix;//last frame's mProjectionMatrix*mViewMatrix
+	vec4 mPrevViewOrigin;
+} U_GlobalConstants;
+//max. depth pyramid,see HZB.glsl
+layout(std430,binding=HZB_BINDING)readonly buffer FHZB{
+    float mData[];
+}HZB;
+bool IsPrevHZBValid(){
+	return (U_GlobalConstants.mMisc0.y&1u)!=0u;
+}
+//nearest depth of the box behind the farthest depth of the HZB texels under its screen rect,
+//bPrevFrame => projects with last frame's camera to match last frame's HZB
+bool IsBoxOccluded(vec3 inCenter,vec3 inExtent,bool bPrevFrame){
+	mat4 viewProjection=U_GlobalConstants.mProjectionMatrix*U_GlobalConstants.mViewMatrix;
+	vec3 viewOrigin=U_GlobalConstants.mNanite_ViewOrigin.xyz;
+	if(bPrevFrame){
+		viewProjection=U_GlobalConstants.mPrevTranslatedViewProjectionMatrix;
+		viewOrigin=U_GlobalConstants.mPrevViewOrigin.xyz;
+	}
+	vec2 rectMin=vec2(1.0f);
+	vec2 rectMax=vec2(-1.0f);
+	float minZ=1.0f;
+	for(uint i=0u;i<8u;i++){
+		vec3 corner=inCenter+inExtent*vec3((i&1u)!=0u?1.0f:-1.0f,(i&2u)!=0u?1.0f:-1.0f,(i&4u)!=0u?1.0f:-1.0f);
+		vec4 clip=viewProjection*vec4((U_GlobalConstants.mModelMatrix*vec4(corner,1.0f)).xyz-viewOrigin,1.0f);
+		if(clip.z<=0.0f){
+			return false;//crosses the near plane
+		}
+		vec3 ndc=clip.xyz/clip.w;
+		rectMin=min(rectMin,ndc.xy);
+		rectMax=max(rectMax,ndc.xy);
+		minZ=min(minZ,ndc.z);
+	}
+	if(any(lessThan(rectMax,vec2(-1.0f)))||any(greaterThan(rectMin,vec2(1.0f)))){
+		return false;//off screen,left to the frustum test
+	}
+	vec2 viewportSize=U_GlobalConstants.mNanite_ViewParams.yz;
+	vec2 pixelMin=clamp(rectMin*0.5f+0.5f,0.0f,1.0f)*viewportSize;
+	vec2 pixelMax=clamp(rectMax*0.5f+0.5f,0.0f,1.0f)*viewportSize;
+	pixelMin=min(pixelMin,viewportSize-1.0f);
+	pixelMax=min(pixelMax,viewportSize-1.0f);
+	//a texel of mip n covers 2^(n+1) pixels,pick the mip where the rect touches at most 2x2 texels
+	float rectSize=max(pixelMax.x-pixelMin.x,pixelMax.y-pixelMin.y);
+	uint mip=min(uint(max(ceil(log2(max(rectSize,1.0f))),1.0f))-1u,GetHZBMipCount(uvec2(viewportSize))-1u);
+	uvec2 mipSize;
+	uint mipOffset=GetHZBMipOffset(uvec2(viewportSize),mip,mipSize);
+	uvec2 texelMin=min(uvec2(pixelMin)>>(mip+1u),mipSize-1u);
+	uvec2 texelMax=min(uvec2(pixelMax)>>(mip+1u),mipSize-1u);
+	float maxDepth=0.0f;
+	for(uint y=texelMin.y;y<=texelMax.y;y++){
+		for(uint x=texelMin.x;x<=texelMax.x;x++){
+			maxDepth=max(maxDepth,HZB.mData[mipOffset+y*mipSize.x+x]);
+		}
+	}
+	return minZ>maxDepth;
+}
+float GetMaxModelScale(){
+	mat4 m=U_GlobalConstants.mModelMatrix;
+	return sqrt(max(max(dot(m[0].xyz,m[0].xyz),dot(m[1].xyz,m[1].xyz)),dot(m[2].xyz,m[2].xyz)));
+}
+//x => min distance scale of the bounds along view direction,y => max. error in world units * lodScale / scale = error in pixels
+vec2 GetProjectedEdgeScales(vec4 inLODBounds){
+	vec3 center=(U_GlobalConstants.mModelMatrix*vec4(inLODBounds.xyz,1.0f)).xyz-U_GlobalConstants.mNanite_ViewOrigin.xyz;
+	float radius=inLODBounds.w*GetMaxModelScale();
+	float zNear=U_GlobalConstants.mNanite_ViewParams.x;
+
+	float distToClusterSq=dot(center,center);
+	float z=dot(U_GlobalConstants.mNanite_ViewForward.xyz,center);
+	float x=sqrt(max(0.0f,distToClusterSq-z*z));
+	float distToTSq=distToClusterSq-radius*radius;
+	float distToT=sqrt(max(0.0f,distToTSq));
+	float scaleToUnit=1.0f/max(distToClusterSq,1e-8f);
+	//cos of the angles between view direction and the two tangents of the bounding sphere
+	float by=(radius*x+distToT*z)*scaleToUnit;
+	float ty=(-radius*x+distToT*z)*scaleToUnit;
+	float h=zNear-z;
+	if(distToTSq<0.0f||by*distToT<zNear){
+		float bx=max(x-sqrt(max(0.0f,radius*radius-h*h)),0.0f);
+		by=zNear*inversesqrt(bx*bx+zNear*zNear);
+	}
+	if(ty*distToT<zNear){
+		float tx=x+sqrt(max(0.0f,radius*radius-h*h));
+		ty=zNear*inversesqrt(tx*tx+zNear*zNear);
+	}
+	if(z+radius<=zNear){
+		return vec2(0.0f,0.0f);
+	}
+	float minZ=max(z-radius,zNear);
+	float maxZ=max(z+radius,zNear);
+	return vec2(minZ*ty,maxZ*by);
+}
+
+#endif
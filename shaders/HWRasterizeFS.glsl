@@ -4,6 +4,9 @@
 layout(std430,binding=3)buffer FVisBuffer64{
     uint64_t mData[];
 }VisBuffer64;
+layout(push_constant)uniform FRasterizeParams{
+	uvec2 mViewSize;
+}RasterizeParams;
 layout(location=0)flat in uvec4 V_PackedData;
 void main(){
     ivec2 texcoord=ivec2(gl_FragCoord.xy);
@@ -11,6 +14,6 @@ void main(){
     uint64_t pixelDepth=floatBitsToUint(z);
     uint64_t pixelValue=V_PackedData.x;
     uint64_t outputPixel=(pixelDepth<<32)|pixelValue;
-    int pixelIndex=texcoord.y*1280+texcoord.x;
+    int pixelIndex=texcoord.y*int(RasterizeParams.mViewSize.x)+texcoord.x;
     atomicMin(VisBuffer64.mData[pixelIndex],outputPixel);
 }
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef HZB_GLSL
+#define HZB_GLSL
+
+// Layout of the max. depth pyramid HZBBuild writes and the culling passes read. Mip 0 is half the viewport,
+// every mip halves the previous one rounding up and the mips are packed back to back.
+uint GetHZBMipCount(uvec2 inViewportSize){
+	uvec2 size=(inViewportSize+1u)/2u;
+	uint mipCount=1u;
+	while(size.x>1u||size.y>1u){
+		size=max((size+1u)/2u,uvec2(1u));
+		mipCount++;
+	}
+	return mipCount;
+}
+uint GetHZBMipOffset(uvec2 inViewportSize,uint inMip,out uvec2 outSize){
+	uvec2 size=(inViewportSize+1u)/2u;
+	uint offset=0u;
+	for(uint i=0u;i<inMip;i++){
+		offset+=size.x*size.y;
+		size=max((size+1u)/2u,uvec2(1u));
+	}
+	outSize=size;
+	return offset;
+}
+
+#endif
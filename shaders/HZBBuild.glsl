@@ -0,0 +1,104 @@
+#version 450
+#extension GL_ARB_gpu_shader_int64 : enable
+
+layout(local_size_x=16,local_size_y=16,local_size_z=1)in;
+
+#define HZB_GROUP_SIZE			16u
+#define HZB_GROUP_MIP_COUNT		5u//mip 0..4 of a 16x16 tile are reduced in shared memory
+#include "HZB.glsl"
+
+layout(binding=0)uniform GlobalConstants {
+	mat4 mProjectionMatrix;
+	mat4 mViewMatrix;//View => translate
+	mat4 mModelMatrix;
+	uvec4 mMisc0;
+	vec4 mNanite_ViewOrigin;//x,y,z,w => lodScale
+	vec4 mNanite_ViewForward;//x,y,z,w => lodScaleHW
+	vec4 mNanite_ViewParams;//x => near plane,y => viewport width,z => viewport height
+} U_GlobalContants;
+layout(std430,binding=1)readonly buffer FVisBuffer64{
+    uint64_t mData[];
+}VisBuffer64;
+//max. depth pyramid,mip 0 is half the viewport,mips are packed back to back
+layout(std430,binding=2)coherent buffer FHZB{
+    float mData[];
+}HZB;
+//finished group count,cleared before the pass runs
+layout(std430,binding=3)buffer FHZBCounter{
+    uint mData[];
+}HZBCounter;
+shared float sDepth[HZB_GROUP_SIZE][HZB_GROUP_SIZE];
+shared bool sIsLastGroup;
+//texels outside the viewport hold 0,the nearest depth never raises the max.
+float LoadDepth(uvec2 inPixel,uvec2 inViewportSize){
+	if(any(greaterThanEqual(inPixel,inViewportSize))){
+		return 0.0f;
+	}
+	uint depthBits=uint(VisBuffer64.mData[inPixel.y*inViewportSize.x+inPixel.x]>>32);
+	return depthBits==0xFFFFFFFFu?1.0f:uintBitsToFloat(depthBits);
+}
+//one invocation per mip 0 texel,the last group to finish reduces the mips above the group tiles
+void main(){
+	uvec2 viewportSize=uvec2(U_GlobalContants.mNanite_ViewParams.yz);
+	uvec2 localId=gl_LocalInvocationID.xy;
+	uvec2 texel=gl_GlobalInvocationID.xy;
+	uvec2 mipSize=(viewportSize+1u)/2u;
+	uint mipOffset=0u;
+	uint mipCount=GetHZBMipCount(viewportSize);
+
+	float depth=0.0f;
+	if(all(lessThan(texel,mipSize))){
+		uvec2 pixel=texel*2u;
+		depth=max(max(LoadDepth(pixel,viewportSize),LoadDepth(pixel+uvec2(1u,0u),viewportSize)),
+			max(LoadDepth(pixel+uvec2(0u,1u),viewportSize),LoadDepth(pixel+uvec2(1u,1u),viewportSize)));
+		HZB.mData[texel.y*mipSize.x+texel.x]=depth;
+	}
+	sDepth[localId.x][localId.y]=depth;
+
+	//mip n of tile texel x is kept at sDepth[x<<n],nobody else reads that slot at the same mip
+	for(uint mip=1u;mip<HZB_GROUP_MIP_COUNT&&mip<mipCount;mip++){
+		mipOffset+=mipSize.x*mipSize.y;
+		mipSize=max((mipSize+1u)/2u,uvec2(1u));
+		barrier();
+		uvec2 tileSize=uvec2(HZB_GROUP_SIZE>>mip);
+		if(all(lessThan(localId,tileSize))){
+			uvec2 src=localId<<mip;
+			uint srcStep=1u<<(mip-1u);
+			depth=max(max(sDepth[src.x][src.y],sDepth[src.x+srcStep][src.y]),
+				max(sDepth[src.x][src.y+srcStep],sDepth[src.x+srcStep][src.y+srcStep]));
+			sDepth[src.x][src.y]=depth;
+			uvec2 dst=gl_WorkGroupID.xy*tileSize+localId;
+			if(all(lessThan(dst,mipSize))){
+				HZB.mData[mipOffset+dst.y*mipSize.x+dst.x]=depth;
+			}
+		}
+	}
+
+	memoryBarrierBuffer();
+	barrier();
+	if(gl_LocalInvocationIndex==0u){
+		uint groupCount=gl_NumWorkGroups.x*gl_NumWorkGroups.y;
+		sIsLastGroup=atomicAdd(HZBCounter.mData[0],1u)==groupCount-1u;
+	}
+	barrier();
+	if(!sIsLastGroup){
+		return;
+	}
+
+	for(uint mip=HZB_GROUP_MIP_COUNT;mip<mipCount;mip++){
+		uint srcOffset=mipOffset;
+		uvec2 srcSize=mipSize;
+		mipOffset+=mipSize.x*mipSize.y;
+		mipSize=max((mipSize+1u)/2u,uvec2(1u));
+		for(uint i=gl_LocalInvocationIndex;i<mipSize.x*mipSize.y;i+=HZB_GROUP_SIZE*HZB_GROUP_SIZE){
+			uvec2 dst=uvec2(i%mipSize.x,i/mipSize.x);
+			uvec2 src0=min(dst*2u,srcSize-1u);
+			uvec2 src1=min(dst*2u+1u,srcSize-1u);
+			depth=max(max(HZB.mData[srcOffset+src0.y*srcSize.x+src0.x],HZB.mData[srcOffset+src0.y*srcSize.x+src1.x]),
+				max(HZB.mData[srcOffset+src1.y*srcSize.x+src0.x],HZB.mData[srcOffset+src1.y*srcSize.x+src1.x]));
+			HZB.mData[mipOffset+dst.y*mipSize.x+dst.x]=depth;
+		}
+		memoryBarrierBuffer();
+		barrier();
+	}
+}
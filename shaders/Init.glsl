@@ -2,38 +2,89 @@
 #extension GL_ARB_gpu_shader_int64 : enable
 
 layout(local_size_x=8,local_size_y=8,local_size_z=1)in;
+#define MAX_CANDIDATE_NODES 1024u
 
-layout(std430,binding=0)buffer FWorkArgs0{
-    uint mData[];
-}WorkArgs0;
-layout(std430,binding=1)buffer FWorkArgs1{
+#ifndef INIT_PASS
+#define INIT_PASS				0
+#endif
+#define INIT_PASS_CULLING		0//work args of both culling passes,runs on the async compute queue
+#define INIT_PASS_VIS_BUFFER	1//clears VisBuffer64,runs on graphics after the previous frame is done with it
+
+#define WORK_ARGS_UINT_COUNT	8u
+
+layout(push_constant)uniform FInitParams{
+	uvec2 mViewSize;
+	uint mLevelCount;//levels behind level 0 in the work args
+}InitParams;
+#if INIT_PASS==INIT_PASS_CULLING
+//an entry of WORK_ARGS_UINT_COUNT per level,see NodeAndClusterCull.glsl
+layout(std430,binding=0)buffer FWorkArgs{
     uint mData[];
-}WorkArgs1;
+}WorkArgs;
 layout(std430,binding=2)buffer FMainAndPostNodeAndClusterBatches{
     uint mData[];
 }MainAndPostNodeAndClusterBatches;
+#endif
+#if INIT_PASS==INIT_PASS_VIS_BUFFER
 layout(std430,binding=3)buffer FVisBuffer64{
     uint64_t mData[];
 }VisBuffer64;
+#endif
+#if INIT_PASS==INIT_PASS_CULLING
+layout(std430,binding=4)buffer FClusterWorkArgs{
+    uint mData[];
+}ClusterWorkArgs;
+layout(std430,binding=5)buffer FPostWorkArgs{
+    uint mData[];
+}PostWorkArgs;
+layout(std430,binding=6)buffer FPostClusterWorkArgs{
+    uint mData[];
+}PostClusterWorkArgs;
+#endif
 void main(){
 	ivec2 texcoord=ivec2(gl_GlobalInvocationID.xy);
-	if(any(greaterThanEqual(texcoord,ivec2(1280,720)))){
+	if(any(greaterThanEqual(texcoord,ivec2(InitParams.mViewSize)))){
 		return ;
 	}
+#if INIT_PASS==INIT_PASS_CULLING
 	if(texcoord.x==0&&texcoord.y==0){
-		WorkArgs0.mData[0]=384u;
-		WorkArgs0.mData[1]=0u;
-		WorkArgs0.mData[2]=0u;
-		WorkArgs0.mData[3]=0u;
-		WorkArgs0.mData[5]=0u;
-		WorkArgs0.mData[6]=1u;
-		WorkArgs1.mData[0]=384u;
-		WorkArgs1.mData[1]=0u;
-		WorkArgs1.mData[2]=0u;
-		WorkArgs1.mData[3]=0u;
-		WorkArgs1.mData[5]=0u;
-		WorkArgs1.mData[6]=1u;
+		//level 0 => one group over the root node
+		WorkArgs.mData[0]=1u;
+		WorkArgs.mData[1]=1u;
+		WorkArgs.mData[2]=1u;
+		WorkArgs.mData[5]=0u;
+		WorkArgs.mData[6]=1u;
+		MainAndPostNodeAndClusterBatches.mData[0]=0u;
+		//every later level is appended to by the one before it
+		for(uint i=WORK_ARGS_UINT_COUNT;i<(InitParams.mLevelCount+1u)*WORK_ARGS_UINT_COUNT;i++){
+			WorkArgs.mData[i]=0u;
+			PostWorkArgs.mData[i]=0u;
+		}
+		ClusterWorkArgs.mData[0]=0u;
+		ClusterWorkArgs.mData[1]=0u;
+		ClusterWorkArgs.mData[2]=1u;
+		ClusterWorkArgs.mData[3]=1u;
+		ClusterWorkArgs.mData[4]=0u;
+		ClusterWorkArgs.mData[5]=0u;
+		ClusterWorkArgs.mData[6]=1u;
+		ClusterWorkArgs.mData[7]=1u;
+		//post level 0 => nodes the main pass defers,its node list starts behind the main one
+		PostWorkArgs.mData[0]=0u;
+		PostWorkArgs.mData[1]=1u;
+		PostWorkArgs.mData[2]=1u;
+		PostWorkArgs.mData[5]=MAX_CANDIDATE_NODES;
+		PostWorkArgs.mData[6]=0u;
+		PostClusterWorkArgs.mData[0]=0u;
+		PostClusterWorkArgs.mData[1]=0u;
+		PostClusterWorkArgs.mData[2]=1u;
+		PostClusterWorkArgs.mData[3]=1u;
+		PostClusterWorkArgs.mData[4]=0u;
+		PostClusterWorkArgs.mData[5]=0u;
+		PostClusterWorkArgs.mData[6]=1u;
+		PostClusterWorkArgs.mData[7]=1u;
 	}
-	int pixelIndex=texcoord.y*1280+texcoord.x;
+#else
+	int pixelIndex=texcoord.y*int(InitParams.mViewSize.x)+texcoord.x;
 	VisBuffer64.mData[pixelIndex]=0xFFFFFFFF00000000ul;
+#endif
 }
\ No newline at end of file
@@ -1,5 +1,5 @@
 #version 450
-layout(local_size_x=1,local_size_y=1,local_size_z=1)in;
+layout(local_size_x=64,local_size_y=1,local_size_z=1)in;
 #define NANITE_MAX_GROUP_PARTS_BITS							5
 #define NANITE_MAX_GROUP_PARTS_MASK							((1 << NANITE_MAX_GROUP_PARTS_BITS) - 1)
 #define NANITE_MAX_GROUP_PARTS								(1 << NANITE_MAX_GROUP_PARTS_BITS)
@@ -13,6 +13,16 @@ layout(local_size_x=1,local_size_y=1,local_size_z=1)in;
 #define NANITE_MAX_BVH_NODE_FANOUT							(1 << NANITE_MAX_BVH_NODE_FANOUT_BITS)
 #define HIERARCHY_NODE_SLICE_SIZE	((4 + 4 + 4 + 1) * 4 * NANITE_MAX_BVH_NODE_FANOUT)
 
+//pushed,both culling passes dispatch the same pipeline
+#define CULLING_PASS_MAIN			0//tests against last frame's HZB,occluded work is deferred to the post pass
+#define CULLING_PASS_POST			1//re-tests the deferred work against the HZB of this frame's main pass
+
+#define NODE_CULL_GROUP_SIZE		64u
+#define WORK_ARGS_UINT_COUNT		8u
+#define CLUSTER_CULL_GROUP_SIZE		64u
+#define MAX_CANDIDATE_NODES			1024u//per pass,main and post node lists live in front of the candidate clusters
+#define CANDIDATE_CLUSTERS_OFFSET	(MAX_CANDIDATE_NODES*2u)
+
 layout(std430,binding=0)buffer FBVHBuffer{
     uint mData[];
 }BVHBuffer;//21
@@ -22,20 +32,27 @@ layout(std430,binding=1)buffer FEchoBuffer{
 layout(std430,binding=2)buffer FMainAndPostNodeAndClusterBatches{
     uint mData[];
 }MainAndPostNodeAndClusterBatches;
-layout(std430,binding=3)buffer FCurrentWorkArgs{
+//an entry of WORK_ARGS_UINT_COUNT per level,x,y,z => dispatch args of the level reading it,5 => node offset,
+//6 => node count. Level n reads entry n and appends to entry n+1,which Init cleared
+layout(std430,binding=3)buffer FWorkArgs{
+    uint mData[];
+}WorkArgs;
+layout(push_constant)uniform FNodeCullParams{
+	uint mLevel;
+	uint mCullingPass;
+}NodeCullParams;
+#define GLOBAL_CONSTANTS_BINDING	5
+#define HZB_BINDING					7
+#include "Culling.glsl"
+//0 => HW visible cluster count,1..3 => SW raster dispatch args,4 => candidate cluster count,5..7 => ClusterCull dispatch args
+//bound to the ClusterWorkArgs of the pass this permutation runs in
+layout(std430,binding=6)buffer FClusterWorkArgs{
     uint mData[];
-}CurrentWorkArgs;
-layout(std430,binding=4)buffer FNextWorkArgs{
+}ClusterWorkArgs;
+//level 0 work args of the post pass,the main pass appends nodes occluded in last frame's HZB here
+layout(std430,binding=8)buffer FPostWorkArgs{
     uint mData[];
-}NextWorkArgs;
-layout(binding=5)uniform GlobalConstants {
-	mat4 mProjectionMatrix;
-	mat4 mViewMatrix;//View => translate
-	mat4 mModelMatrix;
-	uvec4 mMisc0;//0xFFFFFFFFu,x:Manual MipLevel
-	vec4 mNanite_ViewOrigin;//x,y,z,w => lodScale
-	vec4 mNanite_ViewForward;//x,y,z,w => lodScaleHW
-} U_GlobalContants;
+}PostWorkArgs;
 uint BitFieldExtractU32(uint Data, uint Size, uint Offset)
 {
 	// Shift amounts are implicitly &31 in HLSL, so they should be optimized away on most platforms
@@ -101,47 +118,117 @@ FHierarchyNodeSlice GetHierarchyNodeSlice(uint NodeIndex, uint ChildIndex)
 	
 	return UnpackHierarchyNodeSlice(RawData0, RawData1, RawData2, RawData3);
 }
-bool ShouldVisitChild(FHierarchyNodeSlice inHierarchyNodeSlice){
-	//threshold,leaf,bvh index
+//planes of the translated world space frustum(view matrix has no translation),xyz => inward normal
+void GetFrustumPlanes(out vec4 outPlanes[6]){
+	mat4 viewProjection=U_GlobalConstants.mProjectionMatrix*U_GlobalConstants.mViewMatrix;
+	vec4 row0=vec4(viewProjection[0][0],viewProjection[1][0],viewProjection[2][0],viewProjection[3][0]);
+	vec4 row1=vec4(viewProjection[0][1],viewProjection[1][1],viewProjection[2][1],viewProjection[3][1]);
+	vec4 row2=vec4(viewProjection[0][2],viewProjection[1][2],viewProjection[2][2],viewProjection[3][2]);
+	vec4 row3=vec4(viewProjection[0][3],viewProjection[1][3],viewProjection[2][3],viewProjection[3][3]);
+	outPlanes[0]=row3+row0;//left
+	outPlanes[1]=row3-row0;//right
+	outPlanes[2]=row3+row1;//bottom
+	outPlanes[3]=row3-row1;//top
+	outPlanes[4]=row3+row2;//near,conservative for both [0,1] and [-1,1] depth
+	outPlanes[5]=row3-row2;//far
+}
+bool IsBoxInFrustum(vec3 inCenter,vec3 inExtent){
+	mat4 m=U_GlobalConstants.mModelMatrix;
+	vec3 center=(m*vec4(inCenter,1.0f)).xyz-U_GlobalConstants.mNanite_ViewOrigin.xyz;
+	vec3 extent=mat3(abs(m[0].xyz),abs(m[1].xyz),abs(m[2].xyz))*inExtent;
+	vec4 planes[6];
+	GetFrustumPlanes(planes);
+	for(int i=0;i<6;i++){
+		float distance=dot(planes[i].xyz,center)+planes[i].w;
+		float radius=dot(abs(planes[i].xyz),extent);
+		if(distance<-radius){
+			return false;
+		}
+	}
 	return true;
 }
-void main(){//
-	//uint uint uint uint uint | => 
-	uint nodeOffset=CurrentWorkArgs.mData[5];//index in MainAndPostNodeAndClusterBatches 0 1
-	uint nodeCount=CurrentWorkArgs.mData[6];//1 4
+bool IsManualMipLevel(){
+	return U_GlobalConstants.mMisc0.x!=0xFFFFFFFFu;
+}
+//parent error is still visible on screen => children must be refined
+bool ShouldVisitChild(FHierarchyNodeSlice inHierarchyNodeSlice){
+	if(IsManualMipLevel()){
+		return true;
+	}
+	float projectedEdgeScale=GetProjectedEdgeScales(inHierarchyNodeSlice.LODBounds).x;
+	float lodScale=U_GlobalConstants.mNanite_ViewOrigin.w;
+	return projectedEdgeScale<=lodScale*GetMaxModelScale()*inHierarchyNodeSlice.MaxParentLODError;
+}
+//own error projects below the pixel threshold => cluster group can be drawn
+bool SmallEnoughToDraw(FHierarchyNodeSlice inHierarchyNodeSlice){
+	if(IsManualMipLevel()){
+		return inHierarchyNodeSlice.NumPages==U_GlobalConstants.mMisc0.x;
+	}
+	float projectedEdgeScale=GetProjectedEdgeScales(inHierarchyNodeSlice.LODBounds).x;
+	float lodScale=U_GlobalConstants.mNanite_ViewOrigin.w;
+	return projectedEdgeScale>lodScale*GetMaxModelScale()*inHierarchyNodeSlice.MinLODError;
+}
+//one invocation per node x child
+void main(){
+	bool bMainPass=NodeCullParams.mCullingPass==CULLING_PASS_MAIN;
+	uint nodeListEnd=bMainPass?MAX_CANDIDATE_NODES:MAX_CANDIDATE_NODES*2u;//main and post node lists sit back to back
+	uint currentWorkArgs=NodeCullParams.mLevel*WORK_ARGS_UINT_COUNT;
+	uint nextWorkArgs=currentWorkArgs+WORK_ARGS_UINT_COUNT;
+	uint nodeOffset=WorkArgs.mData[currentWorkArgs+5];
+	//the count also holds appends that did not fit into the node list
+	uint nodeCount=min(WorkArgs.mData[currentWorkArgs+6],nodeListEnd-nodeOffset);
+	uint sliceIndex=gl_GlobalInvocationID.x;
+	if(sliceIndex>=nodeCount*NANITE_MAX_BVH_NODE_FANOUT){
+		return;
+	}
+	uint nextNodeOffset=nodeOffset+nodeCount;
+	if(sliceIndex==0u){
+		WorkArgs.mData[nextWorkArgs+5]=nextNodeOffset;
+	}
 
-	uint nextNodeOffsetInBuffer=nodeOffset+nodeCount;//index in MainAndPostNodeAndClusterBatches,1 5
-	uint nodeOutputOffset=nextNodeOffsetInBuffer;//1 5
-	uint nextNodeCount=0;//next level bvh node count;
-	
-	uint clusterOutputOffset=CurrentWorkArgs.mData[1];
-	for(int nodeIndexOffset=0;nodeIndexOffset<nodeCount;nodeIndexOffset++){
-		uint currentNodeIndex=MainAndPostNodeAndClusterBatches.mData[nodeOffset+nodeIndexOffset];//1
-		for(int i=0;i<4;i++){
-			FHierarchyNodeSlice slice=GetHierarchyNodeSlice(currentNodeIndex,i);
-			uint currentSliceMipLevel=slice.NumPages;
-			if(slice.bEnabled){
-				bool bShouldVisitChild=ShouldVisitChild(slice);
-				if(false==slice.bLeaf){
-					MainAndPostNodeAndClusterBatches.mData[nodeOutputOffset]=slice.ChildStartReference;
-					nodeOutputOffset++;
-					nextNodeCount++;
-				}else{
-					if(currentSliceMipLevel==U_GlobalContants.mMisc0.x){
-						uint clusterCountInLeafNode=slice.NumChildren;//
-						uint pageIndex=slice.ChildStartReference>>8;
-						uint clusterOffsetInPage=slice.ChildStartReference & 0xFFu;
-						for(uint i=0u;i<clusterCountInLeafNode;i++){
-							MainAndPostNodeAndClusterBatches.mData[1024+clusterOutputOffset*2]=pageIndex;
-							MainAndPostNodeAndClusterBatches.mData[1024+clusterOutputOffset*2+1]=clusterOffsetInPage+i;
-							clusterOutputOffset++;
-						}
-					}
+	uint currentNodeIndex=MainAndPostNodeAndClusterBatches.mData[nodeOffset+sliceIndex/NANITE_MAX_BVH_NODE_FANOUT];
+	FHierarchyNodeSlice slice=GetHierarchyNodeSlice(currentNodeIndex,sliceIndex%NANITE_MAX_BVH_NODE_FANOUT);
+	if(!slice.bEnabled||!IsBoxInFrustum(slice.BoxBoundsCenter,slice.BoxBoundsExtent)||!ShouldVisitChild(slice)){
+		return;
+	}
+	if(false==slice.bLeaf){
+		if(bMainPass){
+			if(IsPrevHZBValid()&&IsBoxOccluded(slice.BoxBoundsCenter,slice.BoxBoundsExtent,true)){
+				//hidden last frame,the post pass re-tests it against this frame's HZB
+				uint postNodeSlot=atomicAdd(PostWorkArgs.mData[6],1u);
+				if(postNodeSlot<MAX_CANDIDATE_NODES){
+					MainAndPostNodeAndClusterBatches.mData[MAX_CANDIDATE_NODES+postNodeSlot]=slice.ChildStartReference;
+					uint postGroupCount=((postNodeSlot+1u)*NANITE_MAX_BVH_NODE_FANOUT+NODE_CULL_GROUP_SIZE-1u)/NODE_CULL_GROUP_SIZE;
+					atomicMax(PostWorkArgs.mData[0],postGroupCount);
 				}
+				return;
 			}
+		}else if(IsBoxOccluded(slice.BoxBoundsCenter,slice.BoxBoundsExtent,false)){
+			return;
+		}
+		uint nodeSlot=atomicAdd(WorkArgs.mData[nextWorkArgs+6],1u);
+		if(nextNodeOffset+nodeSlot<nodeListEnd){
+			MainAndPostNodeAndClusterBatches.mData[nextNodeOffset+nodeSlot]=slice.ChildStartReference;
+			//next level runs one invocation per child slice of every appended node
+			uint groupCount=((nodeSlot+1u)*NANITE_MAX_BVH_NODE_FANOUT+NODE_CULL_GROUP_SIZE-1u)/NODE_CULL_GROUP_SIZE;
+			atomicMax(WorkArgs.mData[nextWorkArgs],groupCount);
+			WorkArgs.mData[nextWorkArgs+1]=1u;
+			WorkArgs.mData[nextWorkArgs+2]=1u;
 		}
+	}else if(SmallEnoughToDraw(slice)){
+		uint clusterCountInLeafNode=slice.NumChildren;
+		uint pageIndex=slice.ChildStartReference>>8;
+		uint clusterOffsetInPage=slice.ChildStartReference & 0xFFu;
+		uint clusterOutputOffset=atomicAdd(ClusterWorkArgs.mData[4],clusterCountInLeafNode);
+		//main and post candidate lists split the rest of the buffer
+		uint maxCandidateClusters=(uint(MainAndPostNodeAndClusterBatches.mData.length())-CANDIDATE_CLUSTERS_OFFSET)/4;
+		uint candidateClustersOffset=CANDIDATE_CLUSTERS_OFFSET+NodeCullParams.mCullingPass*maxCandidateClusters*2u;
+		uint clusterOutputEnd=min(clusterOutputOffset+clusterCountInLeafNode,maxCandidateClusters);
+		for(uint i=clusterOutputOffset;i<clusterOutputEnd;i++){
+			MainAndPostNodeAndClusterBatches.mData[candidateClustersOffset+i*2]=pageIndex;
+			MainAndPostNodeAndClusterBatches.mData[candidateClustersOffset+i*2+1]=clusterOffsetInPage+i-clusterOutputOffset;
+		}
+		//ClusterCull runs one invocation per candidate
+		atomicMax(ClusterWorkArgs.mData[5],(clusterOutputEnd+CLUSTER_CULL_GROUP_SIZE-1u)/CLUSTER_CULL_GROUP_SIZE);
 	}
-	NextWorkArgs.mData[5]=nextNodeOffsetInBuffer;
-	NextWorkArgs.mData[6]=nextNodeCount;
-	NextWorkArgs.mData[1]=clusterOutputOffset;
-}
\ No newline at end of file
+}
@@ -0,0 +1,128 @@
+#version 450
+#extension GL_ARB_gpu_shader_int64 : enable
+#extension GL_EXT_shader_atomic_int64 : enable
+
+layout(local_size_x=128,local_size_y=1,local_size_z=1)in;
+
+#define SW_RASTER_GROUP_SIZE		128u
+#define SW_RASTER_MAX_VERTICES		256u
+
+layout(binding=0)uniform GlobalConstants {
+	mat4 mProjectionMatrix;
+	mat4 mViewMatrix;//View => translate
+	mat4 mModelMatrix;
+	uvec4 mMisc0;//0xFFFFFFFFu
+	vec4 mNanite_ViewOrigin;//x,y,z,w => lodScale
+	vec4 mNanite_ViewForward;//x,y,z,w => lodScaleHW
+	vec4 mNanite_ViewParams;//x => near plane,y => viewport width,z => viewport height
+}U_GlobalConstants;
+layout(std430,binding=1)readonly buffer FClusterPageData{
+    uint mData[];
+}ClusterPageData;
+//x => absolute index data offset,y => absolute position data offset,z => index count,w => packed visibility id
+//SW raster clusters live in the second half
+layout(std430,binding=2)readonly buffer FVisibleClusterSHWH{
+    uvec4 mData[];
+}VisibleClusterSHWH;
+layout(std430,binding=3)buffer FVisBuffer64{
+    uint64_t mData[];
+}VisBuffer64;
+//1 => SW visible cluster count
+layout(std430,binding=4)readonly buffer FClusterWorkArgs{
+    uint mData[];
+}ClusterWorkArgs;
+//x,y => pixel position,z => depth
+shared vec3 sScreenPositions[SW_RASTER_MAX_VERTICES];
+vec3 GetScreenPosition(uint inPositionDataOffset){
+	vec3 positionMS=uintBitsToFloat(
+		uvec3(
+			ClusterPageData.mData[inPositionDataOffset],
+			ClusterPageData.mData[inPositionDataOffset+1],
+			ClusterPageData.mData[inPositionDataOffset+2]
+		)
+	);
+	vec4 positionWS=U_GlobalConstants.mModelMatrix*vec4(positionMS,1.0f);
+	positionWS=vec4(positionWS.xyz-U_GlobalConstants.mNanite_ViewOrigin.xyz,1.0f);
+	vec4 positionCS=U_GlobalConstants.mProjectionMatrix*(U_GlobalConstants.mViewMatrix*positionWS);
+	//ClusterCull keeps clusters reaching the near plane on HW raster,w is always positive here
+	vec3 positionNDC=positionCS.xyz/positionCS.w;
+	return vec3((positionNDC.xy*0.5f+0.5f)*U_GlobalConstants.mNanite_ViewParams.yz,positionNDC.z);
+}
+float EdgeFunction(vec2 inA,vec2 inB,vec2 inP){
+	return (inB.x-inA.x)*(inP.y-inA.y)-(inB.y-inA.y)*(inP.x-inA.x);
+}
+//samples at pixel centers like the HW rasterizer,shared edges may be written twice which atomicMin tolerates
+void RasterizeTriangle(vec3 inV0,vec3 inV1,vec3 inV2,uint inPackedId){
+	//framebuffer y points down,front faces(counter clockwise in vulkan terms) have a negative area here,
+	//back faces are dropped like VK_CULL_MODE_BACK_BIT does on the HW path
+	float area=EdgeFunction(inV0.xy,inV1.xy,inV2.xy);
+	if(area>=0.0f){
+		return;
+	}
+	vec3 v0=inV0;
+	vec3 v1=inV2;
+	vec3 v2=inV1;
+	area=-area;
+
+	vec2 viewportSize=U_GlobalConstants.mNanite_ViewParams.yz;
+	vec2 boundsMin=min(min(v0.xy,v1.xy),v2.xy);
+	vec2 boundsMax=max(max(v0.xy,v1.xy),v2.xy);
+	ivec2 pixelMin=ivec2(max(ceil(boundsMin-0.5f),vec2(0.0f)));
+	ivec2 pixelMax=ivec2(min(floor(boundsMax-0.5f),viewportSize-1.0f));
+	uint viewportWidth=uint(viewportSize.x);
+	uint64_t pixelValue=uint64_t(inPackedId);
+
+	for(int y=pixelMin.y;y<=pixelMax.y;y++){
+		for(int x=pixelMin.x;x<=pixelMax.x;x++){
+			vec2 pixelCenter=vec2(x,y)+0.5f;
+			float w0=EdgeFunction(v1.xy,v2.xy,pixelCenter);
+			float w1=EdgeFunction(v2.xy,v0.xy,pixelCenter);
+			float w2=EdgeFunction(v0.xy,v1.xy,pixelCenter);
+			if(w0<0.0f||w1<0.0f||w2<0.0f){
+				continue;
+			}
+			//ndc depth is linear in screen space
+			float z=(w0*v0.z+w1*v1.z+w2*v2.z)/area;
+			uint64_t pixelDepth=floatBitsToUint(z);
+			uint pixelIndex=uint(y)*viewportWidth+uint(x);
+			atomicMin(VisBuffer64.mData[pixelIndex],(pixelDepth<<32)|pixelValue);
+		}
+	}
+}
+//one group per SW raster cluster,vertices are transformed once into shared memory,then one invocation per triangle
+void main(){
+	uint maxVisibleClusters=uint(VisibleClusterSHWH.mData.length())/2u;
+	if(gl_WorkGroupID.x>=min(ClusterWorkArgs.mData[1],maxVisibleClusters)){
+		return;
+	}
+	uvec4 visibleCluster=VisibleClusterSHWH.mData[maxVisibleClusters+gl_WorkGroupID.x];
+	//positions are followed by the indices
+	uint vertexCount=(visibleCluster.x-visibleCluster.y)/3u;
+	bool bSharedVertices=vertexCount<=SW_RASTER_MAX_VERTICES;
+	if(bSharedVertices){
+		for(uint i=gl_LocalInvocationID.x;i<vertexCount;i+=SW_RASTER_GROUP_SIZE){
+			sScreenPositions[i]=GetScreenPosition(visibleCluster.y+i*3u);
+		}
+	}
+	barrier();
+
+	uint triangleCount=visibleCluster.z/3u;
+	for(uint triangleIndex=gl_LocalInvocationID.x;triangleIndex<triangleCount;triangleIndex+=SW_RASTER_GROUP_SIZE){
+		uvec3 indices=uvec3(
+			ClusterPageData.mData[visibleCluster.x+triangleIndex*3u],
+			ClusterPageData.mData[visibleCluster.x+triangleIndex*3u+1u],
+			ClusterPageData.mData[visibleCluster.x+triangleIndex*3u+2u]
+		);
+		vec3 v0,v1,v2;
+		if(bSharedVertices){
+			v0=sScreenPositions[indices.x];
+			v1=sScreenPositions[indices.y];
+			v2=sScreenPositions[indices.z];
+		}else{
+			v0=GetScreenPosition(visibleCluster.y+indices.x*3u);
+			v1=GetScreenPosition(visibleCluster.y+indices.y*3u);
+			v2=GetScreenPosition(visibleCluster.y+indices.z*3u);
+		}
+		RasterizeTriangle(v0,v1,v2,visibleCluster.w);
+	}
+}
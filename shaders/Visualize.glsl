@@ -7,6 +7,9 @@ layout(std430,binding=0)buffer FVisBuffer64{
 }VisBuffer64;
 
 layout(binding=1,rgba32f)uniform image2D VisualizeTexture;
+layout(push_constant)uniform FVisualizeParams{
+	uvec2 mViewSize;
+}VisualizeParams;
 uint MurmurMix(uint Hash)
 {
 	Hash ^= Hash >> 16;
@@ -29,11 +32,11 @@ vec3 IntToColor(uint Index)
 }
 void main(){
 	ivec2 texcoord=ivec2(gl_GlobalInvocationID.xy);
-	if(any(greaterThanEqual(texcoord,ivec2(1280,720)))){
+	if(any(greaterThanEqual(texcoord,ivec2(VisualizeParams.mViewSize)))){
 		return ;
 	}
 	vec3 color=vec3(0.0f,0.0f,0.0f);
-	int pixelIndex=texcoord.y*1280+texcoord.x;
+	int pixelIndex=texcoord.y*int(VisualizeParams.mViewSize.x)+texcoord.x;
 	uint64_t pixelValue = VisBuffer64.mData[pixelIndex];//depth | (pageIndex:ClusterIndex)
 	uint packedClusterInfo=uint(pixelValue);
 	if(packedClusterInfo>0){
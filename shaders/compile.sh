@@ -9,9 +9,13 @@ if ! command -v glslc &> /dev/null; then
 fi
 
 echo "Compile Compute Shaders..."
-glslc -fshader-stage=compute -o "${OUTPUT_DIR}/Init.sb" "${SHADER_DIR}/Init.glsl"
+glslc -fshader-stage=compute -DINIT_PASS=0 -o "${OUTPUT_DIR}/Init.sb" "${SHADER_DIR}/Init.glsl"
+glslc -fshader-stage=compute -DINIT_PASS=1 -o "${OUTPUT_DIR}/InitVisBuffer.sb" "${SHADER_DIR}/Init.glsl"
 glslc -fshader-stage=compute -o "${OUTPUT_DIR}/NodeAndClusterCull.sb" "${SHADER_DIR}/NodeAndClusterCull.glsl"
-glslc -fshader-stage=compute -o "${OUTPUT_DIR}/ClusterCull.sb" "${SHADER_DIR}/ClusterCull.glsl"
+glslc -fshader-stage=compute -DCULLING_PASS=0 -o "${OUTPUT_DIR}/ClusterCull.sb" "${SHADER_DIR}/ClusterCull.glsl"
+glslc -fshader-stage=compute -DCULLING_PASS=1 -o "${OUTPUT_DIR}/ClusterCullPost.sb" "${SHADER_DIR}/ClusterCull.glsl"
+glslc -fshader-stage=compute -o "${OUTPUT_DIR}/HZBBuild.sb" "${SHADER_DIR}/HZBBuild.glsl"
+glslc -fshader-stage=compute -o "${OUTPUT_DIR}/SWRasterize.sb" "${SHADER_DIR}/SWRasterize.glsl"
 glslc -fshader-stage=compute -o "${OUTPUT_DIR}/Visualize.sb" "${SHADER_DIR}/Visualize.glsl"
 
 echo "Compile Shaders..."
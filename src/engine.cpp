@@ -2,8 +2,10 @@
 
 #include <exception>
 #include "misc/logger.h"
+#include "render/rhi/memory_allocator.h"
 #include "render/rhi/rhi.h"
 #include "render/window.h"
+#include "scene/scene.h"
 
 namespace Nano
 {
@@ -30,10 +32,12 @@ namespace Nano
 
     void Engine::loop()
     {
-        m_curr_time  = Clock::now();
-        m_is_running = true;
+        m_curr_time   = Clock::now();
+        m_is_running  = true;
+        m_frame_count = 0;
 
-        while (!Window::instance().shouldClose())
+        TimePoint start_time = m_curr_time;
+        while (!shouldStop())
         {
             // time calc and clamp
             TimePoint                     now_time   = Clock::now();
@@ -55,34 +59,80 @@ namespace Nano
             // render tick
             double interpolated = m_accumulator / MS_PER_UPDATE;
             render(static_cast<float>(interpolated));
+            ++m_frame_count;
+        }
+
+        // frames still in flight belong to the measurement
+        vkDeviceWaitIdle(RHI::instance().getDevice());
+        std::chrono::duration<double, std::milli> total_time = Clock::now() - start_time;
+        if (m_frame_count > 0)
+        {
+            INFO("Rendered %u frames in %.2f ms, %.3f ms per frame",
+                 m_frame_count,
+                 total_time.count(),
+                 total_time.count() / m_frame_count);
+        }
+        MemoryAllocator::instance().logStatistics();
+
+        if (!m_options.dump_path.empty() && !g_scene.dumpVisualization(m_options.dump_path.c_str()))
+        {
+            ERROR("Failed to dump visualization to %s.", m_options.dump_path.c_str());
         }
 
         m_is_running = false;
     }
 
+    bool Engine::shouldStop()
+    {
+        if (m_options.frame_count != 0 && m_frame_count >= m_options.frame_count)
+            return true;
+
+        return !m_options.is_headless && Window::instance().shouldClose();
+    }
+
     void Engine::init()
     {
         if (m_is_running)
             return;
 
-        Window::instance();
+        // a headless run never touches the window, so GLFW is not even initialized
+        uint32_t width  = m_options.width;
+        uint32_t height = m_options.height;
+        if (m_options.is_headless)
+        {
+            if (m_options.frame_count == 0)
+                m_options.frame_count = DEFAULT_HEADLESS_FRAME_COUNT;
+            RHI::setHeadless(true);
+        }
+        else
+        {
+            Window& window = Window::instance();
+            width          = static_cast<uint32_t>(window.getWidth());
+            height         = static_cast<uint32_t>(window.getHeight());
+        }
+        RHI::setBindless(m_options.is_bindless);
         RHI::instance();
+
+        if (!g_scene.initialize(width, height))
+        {
+            ERROR("Failed to initialize scene.");
+        }
     }
 
     void Engine::update(double deltaTime)
     {
-        Window::instance().pollEvents();
+        if (!m_options.is_headless)
+            Window::instance().pollEvents();
 
         // TODO: other system updates;
     }
 
-    void Engine::render(float interpolation)
-    {
-        // TODO: draw call here.
-    }
+    void Engine::render(float interpolation) { g_scene.render(); }
 
     void Engine::clean()
     {
+        g_scene.cleanup();
+
         m_is_running  = false;
         m_accumulator = std::chrono::duration<double>::zero();
     }
@@ -2,13 +2,30 @@
 #define ENGINE_H
 
 #include <chrono>
+#include <cstdint>
+#include <string>
 
 namespace Nano
 {
+    struct EngineOptions
+    {
+        // no window, surface or swapchain, the frame only renders into offscreen targets
+        bool        is_headless {false};
+        // buffers and textures register in a global descriptor indexing heap, if the device supports it
+        bool        is_bindless {false};
+        uint32_t    width {1280}; // windowed runs take the window size
+        uint32_t    height {720};
+        uint32_t    frame_count {0}; // frames to render before exiting, 0 => until the window closes or 100 headless
+        std::string dump_path;       // writes the last frame's visualize output there on exit, as a binary PPM
+    };
+
     class Engine
     {
     public:
-        Engine()           = default;
+        Engine() = default;
+        explicit Engine(const EngineOptions& options)
+            : m_options(options)
+        {}
         ~Engine() noexcept = default;
 
         Engine(const Engine& other)                = delete;
@@ -26,7 +43,9 @@ namespace Nano
 
     private:
         void loop();
+        bool shouldStop();
 
+        static constexpr uint32_t                      DEFAULT_HEADLESS_FRAME_COUNT {100};
         static constexpr double                        MAX_DELTA_TIME_STEP {0.25};
         static constexpr double                        PHYSICAL_TICK_RATE {60.0}; // 60 times ticking per second
         static constexpr std::chrono::duration<double> MS_PER_UPDATE {
@@ -35,6 +54,9 @@ namespace Nano
         using Clock     = std::chrono::high_resolution_clock;
         using TimePoint = Clock::time_point;
 
+        EngineOptions m_options;
+        uint32_t      m_frame_count {0};
+
         TimePoint                     m_curr_time;
         std::chrono::duration<double> m_accumulator {std::chrono::duration<double>::zero()};
 
@@ -1,9 +1,46 @@
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include "engine.h"
 
+static void printUsage(const char* program)
+{
+    std::printf("Usage: %s [--headless] [--bindless] [--frames <count>] [--dump <file.ppm>]\n", program);
+    std::printf("  --headless        render offscreen without a window, e.g. on lavapipe\n");
+    std::printf("  --bindless        put buffers and textures into a global descriptor indexing heap\n");
+    std::printf("  --frames <count>  exit after count frames and log the average frame time\n");
+    std::printf("  --dump <file>     write the last frame's visualize output as a binary PPM\n");
+}
+
 int main(int argc, char** argv)
 {
-    Nano::Engine engine;
+    Nano::EngineOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--headless") == 0)
+        {
+            options.is_headless = true;
+        }
+        else if (std::strcmp(argv[i], "--bindless") == 0)
+        {
+            options.is_bindless = true;
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            options.frame_count = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+        {
+            options.dump_path = argv[++i];
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Nano::Engine engine(options);
     engine.run();
 
     return EXIT_SUCCESS;
@@ -0,0 +1,101 @@
+#include "mapped_file.h"
+#include <cstdio>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "misc/logger.h"
+
+namespace Nano
+{
+    MappedFile::MappedFile() {}
+
+    MappedFile::~MappedFile() noexcept { close(); }
+
+    bool MappedFile::open(const char* path)
+    {
+        close();
+
+#ifndef _WIN32
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            ERROR("Failed to open file: %s", path);
+            return false;
+        }
+
+        struct stat file_stat {};
+        if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0)
+        {
+            ERROR("File is empty or invalid: %s", path);
+            ::close(fd);
+            return false;
+        }
+
+        // the mapping keeps the file referenced, the descriptor is not needed any more
+        void* data = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data != MAP_FAILED)
+        {
+            m_data      = static_cast<const uint8_t*>(data);
+            m_size      = static_cast<size_t>(file_stat.st_size);
+            m_is_mapped = true;
+            return true;
+        }
+
+        WARN("Failed to map file, reading it instead: %s", path);
+#endif
+
+        FILE* file = std::fopen(path, "rb");
+        if (file == nullptr)
+        {
+            ERROR("Failed to open file: %s", path);
+            return false;
+        }
+
+        std::fseek(file, 0, SEEK_END);
+        long file_size = std::ftell(file);
+        std::rewind(file);
+
+        if (file_size <= 0)
+        {
+            ERROR("File is empty or invalid: %s", path);
+            std::fclose(file);
+            return false;
+        }
+
+        m_buffer.resize(static_cast<size_t>(file_size));
+        size_t read_size = std::fread(m_buffer.data(), 1, m_buffer.size(), file);
+        std::fclose(file);
+
+        if (read_size != m_buffer.size())
+        {
+            ERROR("Failed to read file completely: %s (read %zu/%ld)", path, read_size, file_size);
+            m_buffer.clear();
+            return false;
+        }
+
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+#ifndef _WIN32
+        if (m_is_mapped)
+        {
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+        }
+#endif
+
+        m_buffer.clear();
+        m_buffer.shrink_to_fit();
+        m_data      = nullptr;
+        m_size      = 0;
+        m_is_mapped = false;
+    }
+
+} // namespace Nano
@@ -0,0 +1,39 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Nano
+{
+    // Read-only view of a whole file, mapped into memory where the platform allows it and read into a buffer
+    // otherwise. The data stays valid until close() or destruction.
+    class MappedFile final
+    {
+    public:
+        MappedFile();
+        ~MappedFile() noexcept;
+
+        MappedFile(const MappedFile&)                = delete;
+        MappedFile& operator=(const MappedFile&)     = delete;
+        MappedFile(MappedFile&&) noexcept            = delete;
+        MappedFile& operator=(MappedFile&&) noexcept = delete;
+
+        // Empty files fail as well, there is nothing to map.
+        bool open(const char* path);
+        void close();
+
+        const uint8_t* getData() const { return m_data; }
+        size_t         getSize() const { return m_size; }
+
+    private:
+        const uint8_t*       m_data {nullptr};
+        size_t               m_size {0};
+        bool                 m_is_mapped {false};
+        std::vector<uint8_t> m_buffer; // holds the data when the file could not be mapped
+    };
+
+} // namespace Nano
+
+#endif // !MAPPED_FILE_H
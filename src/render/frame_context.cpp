@@ -0,0 +1,125 @@
+#include "frame_context.h"
+#include "misc/logger.h"
+#include "render/rhi/descriptor_allocator.h"
+#include "render/rhi/rhi.h"
+
+namespace Nano
+{
+    FrameContext::FrameContext() {}
+
+    FrameContext::~FrameContext() noexcept { cleanup(); }
+
+    void FrameContext::cleanup()
+    {
+        waitSubmissions();
+
+        if (!m_command_buffers.empty())
+        {
+            m_command_buffers.clear();
+            DEBUG("  Destroyed frame context");
+        }
+
+        for (uint64_t& submitted_value : m_submitted_values)
+        {
+            submitted_value = 0;
+        }
+    }
+
+    bool FrameContext::create(uint32_t frame_slot)
+    {
+        if (frame_slot >= MAX_FRAMES_IN_FLIGHT)
+        {
+            ERROR("Invalid frame slot %u.", frame_slot);
+            return false;
+        }
+
+        m_frame_slot = frame_slot;
+        return true;
+    }
+
+    bool FrameContext::waitSubmissions() const
+    {
+        RHI& rhi = RHI::instance();
+
+        // the timelines start at 0, so a queue the frame never submitted to has nothing to wait for
+        for (uint32_t queue_type = 0; queue_type < QUEUE_TYPE_COUNT; ++queue_type)
+        {
+            if (!rhi.waitTimelineValue(rhi.getTimeline(static_cast<QueueType>(queue_type)),
+                                       m_submitted_values[queue_type]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool FrameContext::begin()
+    {
+        if (!waitSubmissions())
+        {
+            ERROR("Failed to wait for frame submission.");
+            return false;
+        }
+
+        // the buffers go back to the pools, which are reset right after
+        m_command_buffers.clear();
+        CommandAllocator::instance().beginFrame(m_frame_slot);
+        DescriptorAllocator::instance().beginFrame(m_frame_slot);
+
+        return true;
+    }
+
+    CommandBuffer* FrameContext::beginCommandBuffer(QueueType queue_type)
+    {
+        auto command_buffer = std::make_unique<CommandBuffer>();
+        if (!command_buffer->create(VK_COMMAND_BUFFER_LEVEL_PRIMARY, m_frame_slot, queue_type) ||
+            !command_buffer->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT))
+        {
+            ERROR("Failed to begin frame command buffer.");
+            return nullptr;
+        }
+
+        m_command_buffers.push_back(std::move(command_buffer));
+        return m_command_buffers.back().get();
+    }
+
+    bool FrameContext::submit(CommandBuffer&                         cmd,
+                              std::initializer_list<SemaphoreSubmit> waits,
+                              uint64_t&                              out_signal_value)
+    {
+        if (!cmd.end())
+        {
+            ERROR("Failed to end frame command buffer.");
+            return false;
+        }
+
+        // the value is signaled even if the submission fails, so it is safe to wait for either way
+        bool is_submitted = cmd.submitTimeline(out_signal_value, waits);
+        m_submitted_values[static_cast<uint32_t>(cmd.getQueueType())] = out_signal_value;
+        if (!is_submitted)
+        {
+            ERROR("Failed to submit frame command buffer.");
+            return false;
+        }
+
+        return true;
+    }
+
+    bool FrameContext::isRetired() const
+    {
+        RHI& rhi = RHI::instance();
+
+        for (uint32_t queue_type = 0; queue_type < QUEUE_TYPE_COUNT; ++queue_type)
+        {
+            if (!rhi.isTimelineValueReached(rhi.getTimeline(static_cast<QueueType>(queue_type)),
+                                            m_submitted_values[queue_type]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+} // namespace Nano
@@ -0,0 +1,59 @@
+#ifndef FRAME_CONTEXT_H
+#define FRAME_CONTEXT_H
+
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+#include "render/rhi/command_allocator.h"
+#include "render/rhi/command_buffer.h"
+
+namespace Nano
+{
+    // Recording state of one frame. MAX_FRAMES_IN_FLIGHT of them are cycled, so the CPU records the next frame
+    // while the GPU still works on the previous ones and only waits once it laps the GPU.
+    class FrameContext
+    {
+    public:
+        static constexpr uint32_t MAX_FRAMES_IN_FLIGHT {CommandAllocator::FRAME_SLOT_COUNT};
+
+        FrameContext();
+        ~FrameContext() noexcept;
+
+        FrameContext(const FrameContext&)                = delete;
+        FrameContext& operator=(const FrameContext&)     = delete;
+        FrameContext(FrameContext&&) noexcept            = delete;
+        FrameContext& operator=(FrameContext&&) noexcept = delete;
+
+        // One context per frame slot, its command buffers come from the CommandAllocator pools of that slot.
+        bool create(uint32_t frame_slot);
+
+        // Waits for the last submissions of this context on every queue to retire and recycles the slot's command
+        // pools.
+        bool begin();
+        // Command buffer for one submission of the frame, already recording. It stays alive until the next begin().
+        CommandBuffer* beginCommandBuffer(QueueType queue_type = QueueType::Graphics);
+        // Ends and submits a buffer of beginCommandBuffer(). The work is retired once the RHI timeline of its queue
+        // reaches out_signal_value.
+        bool submit(CommandBuffer& cmd, std::initializer_list<SemaphoreSubmit> waits, uint64_t& out_signal_value);
+        bool isRetired() const;
+
+        // Timeline value of the frame's last submission to the queue, 0 => nothing submitted.
+        uint64_t getSubmittedValue(QueueType queue_type) const
+        {
+            return m_submitted_values[static_cast<uint32_t>(queue_type)];
+        }
+
+    private:
+        void cleanup();
+        bool waitSubmissions() const;
+
+        std::vector<std::unique_ptr<CommandBuffer>> m_command_buffers;
+        uint64_t                                    m_submitted_values[QUEUE_TYPE_COUNT] {};
+        uint32_t                                    m_frame_slot {0};
+    };
+
+} // namespace Nano
+
+#endif // !FRAME_CONTEXT_H
@@ -1,11 +1,13 @@
 #include "material.h"
 #include <cstring>
 #include "misc/logger.h"
+#include "render/rhi/bindless_heap.h"
 #include "render/rhi/buffer.h"
 #include "render/rhi/command_buffer.h"
 #include "render/rhi/descriptor_set.h"
 #include "render/rhi/pipeline.h"
 #include "render/rhi/shader.h"
+#include "render/rhi/shader_library.h"
 #include "render/rhi/texture.h"
 
 namespace Nano
@@ -95,15 +97,15 @@ namespace Nano
             return false;
         }
 
-        m_vertex_shader = std::make_unique<Shader>();
-        if (!m_vertex_shader->loadFromFile(vertex_shader_path))
+        m_vertex_shader = ShaderLibrary::instance().load(vertex_shader_path);
+        if (!m_vertex_shader)
         {
             ERROR("Failed to load vertex shader: %s", vertex_shader_path);
             return false;
         }
 
-        m_fragment_shader = std::make_unique<Shader>();
-        if (!m_fragment_shader->loadFromFile(fragment_shader_path))
+        m_fragment_shader = ShaderLibrary::instance().load(fragment_shader_path);
+        if (!m_fragment_shader)
         {
             ERROR("Failed to load fragment shader: %s", fragment_shader_path);
             return false;
@@ -128,22 +130,22 @@ namespace Nano
             return false;
         }
 
-        m_vertex_shader = std::make_unique<Shader>();
-        if (!m_vertex_shader->loadFromFile(vertex_shader_path))
+        m_vertex_shader = ShaderLibrary::instance().load(vertex_shader_path);
+        if (!m_vertex_shader)
         {
             ERROR("Failed to load vertex shader: %s", vertex_shader_path);
             return false;
         }
 
-        m_geometry_shader = std::make_unique<Shader>();
-        if (!m_geometry_shader->loadFromFile(geometry_shader_path))
+        m_geometry_shader = ShaderLibrary::instance().load(geometry_shader_path);
+        if (!m_geometry_shader)
         {
             ERROR("Failed to load geometry shader: %s", geometry_shader_path);
             return false;
         }
 
-        m_fragment_shader = std::make_unique<Shader>();
-        if (!m_fragment_shader->loadFromFile(fragment_shader_path))
+        m_fragment_shader = ShaderLibrary::instance().load(fragment_shader_path);
+        if (!m_fragment_shader)
         {
             ERROR("Failed to load fragment shader: %s", fragment_shader_path);
             return false;
@@ -169,29 +171,29 @@ namespace Nano
             return false;
         }
 
-        m_vertex_shader = std::make_unique<Shader>();
-        if (!m_vertex_shader->loadFromFile(vertex_shader_path))
+        m_vertex_shader = ShaderLibrary::instance().load(vertex_shader_path);
+        if (!m_vertex_shader)
         {
             ERROR("Failed to load vertex shader: %s", vertex_shader_path);
             return false;
         }
 
-        m_tessellation_control_shader = std::make_unique<Shader>();
-        if (!m_tessellation_control_shader->loadFromFile(tessellation_control_shader_path))
+        m_tessellation_control_shader = ShaderLibrary::instance().load(tessellation_control_shader_path);
+        if (!m_tessellation_control_shader)
         {
             ERROR("Failed to load tessellation control shader: %s", tessellation_control_shader_path);
             return false;
         }
 
-        m_tessellation_evaluation_shader = std::make_unique<Shader>();
-        if (!m_tessellation_evaluation_shader->loadFromFile(tessellation_evaluation_shader_path))
+        m_tessellation_evaluation_shader = ShaderLibrary::instance().load(tessellation_evaluation_shader_path);
+        if (!m_tessellation_evaluation_shader)
         {
             ERROR("Failed to load tessellation evaluation shader: %s", tessellation_evaluation_shader_path);
             return false;
         }
 
-        m_fragment_shader = std::make_unique<Shader>();
-        if (!m_fragment_shader->loadFromFile(fragment_shader_path))
+        m_fragment_shader = ShaderLibrary::instance().load(fragment_shader_path);
+        if (!m_fragment_shader)
         {
             ERROR("Failed to load fragment shader: %s", fragment_shader_path);
             return false;
@@ -297,6 +299,7 @@ namespace Nano
         pipeline_info.viewport              = m_viewport;
         pipeline_info.scissor               = m_scissor;
         pipeline_info.descriptor_set_layout = m_descriptor_set_layout->getLayout();
+        pipeline_info.bindless_set_layout   = BindlessHeap::instance().getLayout();
 
         if (!m_pipeline->createGraphicsPipeline(pipeline_info))
         {
@@ -338,6 +341,8 @@ namespace Nano
 
         vkCmdBindDescriptorSets(
             vk_cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+        // no-op unless the RHI runs bindless
+        BindlessHeap::instance().bind(vk_cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout);
 
         return true;
     }
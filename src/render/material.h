@@ -54,11 +54,11 @@ namespace Nano
         bool createPipeline(VkRenderPass render_pass);
         void cleanup();
 
-        std::unique_ptr<Shader> m_vertex_shader;
-        std::unique_ptr<Shader> m_fragment_shader;
-        std::unique_ptr<Shader> m_geometry_shader;
-        std::unique_ptr<Shader> m_tessellation_control_shader;
-        std::unique_ptr<Shader> m_tessellation_evaluation_shader;
+        std::shared_ptr<Shader> m_vertex_shader;
+        std::shared_ptr<Shader> m_fragment_shader;
+        std::shared_ptr<Shader> m_geometry_shader;
+        std::shared_ptr<Shader> m_tessellation_control_shader;
+        std::shared_ptr<Shader> m_tessellation_evaluation_shader;
 
         std::unique_ptr<Pipeline> m_pipeline;
 
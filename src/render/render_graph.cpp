@@ -0,0 +1,650 @@
+#include "render_graph.h"
+#include <algorithm>
+#include "misc/logger.h"
+#include "render/frame_context.h"
+#include "render/render_pass.h"
+#include "render/rhi/buffer.h"
+#include "render/rhi/command_buffer.h"
+#include "render/rhi/resource_state.h"
+#include "render/rhi/rhi.h"
+#include "render/rhi/texture.h"
+#include "render/rhi/upload_context.h"
+
+namespace Nano
+{
+    RenderGraphPass& RenderGraphPass::read(Buffer* buffer)
+    {
+        m_reads.push_back(m_graph->getResourceIndex(buffer, nullptr));
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::read(Texture* texture)
+    {
+        m_reads.push_back(m_graph->getResourceIndex(nullptr, texture));
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::write(Buffer* buffer)
+    {
+        m_writes.push_back(m_graph->getResourceIndex(buffer, nullptr));
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::write(Texture* texture)
+    {
+        m_writes.push_back(m_graph->getResourceIndex(nullptr, texture));
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::use(const RenderPass& render_pass)
+    {
+        std::vector<ResourceAccess> accesses;
+        render_pass.getAccesses(accesses);
+
+        // storage outputs are read-modify-write, they depend on the earlier writers too
+        for (const ResourceAccess& access : accesses)
+        {
+            uint32_t resource_index = m_graph->getResourceIndex(access.buffer, access.texture);
+            if ((access.access & BarrierBatch::WRITE_ACCESS_MASK) != 0)
+            {
+                m_writes.push_back(resource_index);
+            }
+            if ((access.access & ~BarrierBatch::WRITE_ACCESS_MASK) != 0)
+            {
+                m_reads.push_back(resource_index);
+            }
+        }
+
+        for (Buffer* clear_buffer : render_pass.getClearBuffers())
+        {
+            write(clear_buffer);
+        }
+
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::setQueue(QueueType queue_type)
+    {
+        if (m_graph->m_is_compiled)
+        {
+            WARN("Queue of pass %s changed after the render graph was compiled.", m_name.c_str());
+            return *this;
+        }
+
+        m_queue_type = queue_type;
+        return *this;
+    }
+
+    RenderGraph::RenderGraph() {}
+
+    RenderGraph::~RenderGraph() noexcept { cleanup(); }
+
+    void RenderGraph::cleanup()
+    {
+        // resources go first, they are bound to the blocks
+        m_passes.clear();
+        m_resource_indices.clear();
+        m_resources.clear();
+
+        for (MemoryBlock& memory_block : m_memory_blocks)
+        {
+            if (memory_block.allocation.memory != VK_NULL_HANDLE)
+            {
+                MemoryAllocator::instance().free(memory_block.allocation);
+                DEBUG("  Released render graph memory");
+            }
+        }
+        m_memory_blocks.clear();
+        m_segments.clear();
+
+        m_tail_begin            = 0;
+        m_transient_memory_size = 0;
+        m_is_compiled           = false;
+        m_is_culling_dirty      = true;
+    }
+
+    Buffer* RenderGraph::createBuffer(const char* name, VkBufferUsageFlags usage, size_t size)
+    {
+        auto buffer = std::make_unique<Buffer>();
+        if (!buffer->createUnbound(usage, size))
+        {
+            ERROR("Failed to create transient buffer %s.", name);
+            return nullptr;
+        }
+
+        Resource resource;
+        resource.name             = name;
+        resource.buffer           = buffer.get();
+        resource.transient_buffer = std::move(buffer);
+
+        m_resource_indices[resource.buffer] = static_cast<uint32_t>(m_resources.size());
+        m_resources.push_back(std::move(resource));
+        return m_resources.back().buffer;
+    }
+
+    Texture* RenderGraph::createTexture(const char*       name,
+                                        uint32_t          width,
+                                        uint32_t          height,
+                                        VkFormat          format,
+                                        VkImageUsageFlags usage)
+    {
+        auto texture = std::make_unique<Texture>();
+        if (!texture->createUnbound(width, height, format, usage))
+        {
+            ERROR("Failed to create transient texture %s.", name);
+            return nullptr;
+        }
+
+        Resource resource;
+        resource.name              = name;
+        resource.texture           = texture.get();
+        resource.transient_texture = std::move(texture);
+
+        m_resource_indices[resource.texture] = static_cast<uint32_t>(m_resources.size());
+        m_resources.push_back(std::move(resource));
+        return m_resources.back().texture;
+    }
+
+    uint32_t RenderGraph::getResourceIndex(Buffer* buffer, Texture* texture)
+    {
+        const void* key = buffer != nullptr ? static_cast<const void*>(buffer) : static_cast<const void*>(texture);
+
+        auto it = m_resource_indices.find(key);
+        if (it != m_resource_indices.end())
+        {
+            return it->second;
+        }
+
+        // first sight of something the graph did not create
+        Resource resource;
+        resource.buffer  = buffer;
+        resource.texture = texture;
+
+        uint32_t resource_index = static_cast<uint32_t>(m_resources.size());
+        m_resource_indices[key] = resource_index;
+        m_resources.push_back(std::move(resource));
+        return resource_index;
+    }
+
+    RenderGraphPass& RenderGraph::addPass(const char* name, std::function<void(CommandBuffer&)> record)
+    {
+        auto pass      = std::make_unique<RenderGraphPass>();
+        pass->m_graph  = this;
+        pass->m_name   = name;
+        pass->m_record = std::move(record);
+
+        m_passes.push_back(std::move(pass));
+        m_is_culling_dirty = true;
+        return *m_passes.back();
+    }
+
+    RenderGraphPass& RenderGraph::addPass(RenderPass* render_pass)
+    {
+        return addPass(render_pass->getName().c_str(), [render_pass](CommandBuffer& cmd) { render_pass->record(cmd); })
+            .use(*render_pass);
+    }
+
+    void RenderGraph::setOutput(Buffer* buffer, bool is_output)
+    {
+        Resource& resource = m_resources[getResourceIndex(buffer, nullptr)];
+        if (resource.is_output != is_output)
+        {
+            resource.is_output = is_output;
+            m_is_culling_dirty = true;
+        }
+    }
+
+    void RenderGraph::setOutput(Texture* texture, bool is_output)
+    {
+        Resource& resource = m_resources[getResourceIndex(nullptr, texture)];
+        if (resource.is_output != is_output)
+        {
+            resource.is_output = is_output;
+            m_is_culling_dirty = true;
+        }
+    }
+
+    bool RenderGraph::compile()
+    {
+        if (m_is_compiled)
+        {
+            ERROR("Render graph is already compiled.");
+            return false;
+        }
+
+        for (uint32_t pass_index = 0; pass_index < m_passes.size(); ++pass_index)
+        {
+            const RenderGraphPass& pass = *m_passes[pass_index];
+            for (const std::vector<uint32_t>* resource_indices : {&pass.m_reads, &pass.m_writes})
+            {
+                for (uint32_t resource_index : *resource_indices)
+                {
+                    Resource& resource  = m_resources[resource_index];
+                    resource.first_pass = std::min(resource.first_pass, pass_index);
+                    resource.last_pass  = pass_index;
+                }
+            }
+        }
+
+        updateQueues();
+
+        if (!allocateMemoryBlocks())
+        {
+            return false;
+        }
+
+        updateCulling();
+        m_is_compiled = true;
+        return true;
+    }
+
+    void RenderGraph::updateQueues()
+    {
+        RHI& rhi = RHI::instance();
+
+        // a queue of the graphics family would only add semaphores between passes that run in order anyway
+        uint32_t last_async_pass = INVALID_INDEX;
+        for (uint32_t pass_index = 0; pass_index < m_passes.size(); ++pass_index)
+        {
+            RenderGraphPass& pass = *m_passes[pass_index];
+            if (rhi.getQueueFamilyIndex(pass.m_queue_type) == rhi.getGraphicsQueueFamilyIndex())
+            {
+                pass.m_queue_type = QueueType::Graphics;
+                continue;
+            }
+
+            last_async_pass = pass_index;
+            for (const std::vector<uint32_t>* resource_indices : {&pass.m_reads, &pass.m_writes})
+            {
+                for (uint32_t resource_index : *resource_indices)
+                {
+                    m_resources[resource_index].is_async = true;
+                }
+            }
+        }
+
+        m_tail_begin = static_cast<uint32_t>(m_passes.size());
+        if (last_async_pass == INVALID_INDEX)
+        {
+            return;
+        }
+
+        // the tail starts behind the last pass sharing anything with the other queues
+        m_tail_begin = last_async_pass + 1;
+        for (uint32_t pass_index = last_async_pass + 1; pass_index < m_passes.size(); ++pass_index)
+        {
+            const RenderGraphPass& pass = *m_passes[pass_index];
+            for (const std::vector<uint32_t>* resource_indices : {&pass.m_reads, &pass.m_writes})
+            {
+                for (uint32_t resource_index : *resource_indices)
+                {
+                    if (m_resources[resource_index].is_async)
+                    {
+                        m_tail_begin = pass_index + 1;
+                    }
+                }
+            }
+        }
+
+        for (uint32_t pass_index = m_tail_begin; pass_index < m_passes.size(); ++pass_index)
+        {
+            const RenderGraphPass& pass = *m_passes[pass_index];
+            for (const std::vector<uint32_t>* resource_indices : {&pass.m_reads, &pass.m_writes})
+            {
+                for (uint32_t resource_index : *resource_indices)
+                {
+                    m_resources[resource_index].is_tail = true;
+                }
+            }
+        }
+    }
+
+    bool RenderGraph::allocateMemoryBlocks()
+    {
+
+        std::vector<uint32_t>             transient_indices;
+        std::vector<VkMemoryRequirements> requirements(m_resources.size());
+        VkDeviceSize                      unaliased_size = 0;
+        for (uint32_t resource_index = 0; resource_index < m_resources.size(); ++resource_index)
+        {
+            const Resource& resource = m_resources[resource_index];
+            if (!isTransient(resource))
+            {
+                continue;
+            }
+
+            if (resource.first_pass == INVALID_INDEX)
+            {
+                WARN("Transient resource %s is not used by any pass.", resource.name.c_str());
+            }
+
+            requirements[resource_index] = resource.buffer != nullptr ? resource.buffer->getMemoryRequirements() :
+                                                                        resource.texture->getMemoryRequirements();
+            unaliased_size += requirements[resource_index].size;
+            transient_indices.push_back(resource_index);
+        }
+
+        // biggest first, so the small ones fill the gaps in the lifetimes of the blocks they create
+        std::sort(transient_indices.begin(), transient_indices.end(), [&](uint32_t a, uint32_t b) {
+            return requirements[a].size > requirements[b].size;
+        });
+
+        // every resource of a block is bound at offset 0, their lifetimes don't overlap
+        for (uint32_t resource_index : transient_indices)
+        {
+            Resource&                   resource         = m_resources[resource_index];
+            const VkMemoryRequirements& mem_requirements = requirements[resource_index];
+
+            for (uint32_t block_index = 0; block_index < m_memory_blocks.size(); ++block_index)
+            {
+                MemoryBlock& memory_block = m_memory_blocks[block_index];
+                if ((memory_block.memory_type_bits & mem_requirements.memoryTypeBits) == 0)
+                {
+                    continue;
+                }
+
+                // the next frame's async passes already run while the tail of this one still uses its memory
+                bool is_overlapping = std::any_of(
+                    memory_block.resources.begin(), memory_block.resources.end(), [&](uint32_t other_index) {
+                        const Resource& other = m_resources[other_index];
+                        return (resource.first_pass <= other.last_pass && other.first_pass <= resource.last_pass) ||
+                               (resource.is_async && other.is_tail) || (resource.is_tail && other.is_async);
+                    });
+                if (!is_overlapping)
+                {
+                    resource.memory_block = block_index;
+                    break;
+                }
+            }
+
+            if (resource.memory_block == INVALID_INDEX)
+            {
+                resource.memory_block = static_cast<uint32_t>(m_memory_blocks.size());
+                m_memory_blocks.emplace_back();
+                m_memory_blocks.back().memory_type_bits = mem_requirements.memoryTypeBits;
+            }
+
+            MemoryBlock& memory_block = m_memory_blocks[resource.memory_block];
+            memory_block.size         = std::max(memory_block.size, mem_requirements.size);
+            memory_block.memory_type_bits &= mem_requirements.memoryTypeBits;
+            memory_block.resources.push_back(resource_index);
+        }
+
+        for (MemoryBlock& memory_block : m_memory_blocks)
+        {
+            // aliased memory is sized for the largest resource of the block, it is never sub-allocated
+            VkMemoryRequirements block_requirements = {};
+            block_requirements.size                 = memory_block.size;
+            block_requirements.alignment            = 1;
+            block_requirements.memoryTypeBits       = memory_block.memory_type_bits;
+
+            if (!MemoryAllocator::instance().allocateDedicated(
+                    block_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory_block.allocation))
+            {
+                ERROR("Failed to allocate render graph memory.");
+                return false;
+            }
+            m_transient_memory_size += memory_block.size;
+
+            for (uint32_t resource_index : memory_block.resources)
+            {
+                Resource& resource = m_resources[resource_index];
+                bool      is_bound = false;
+                if (resource.buffer != nullptr)
+                {
+                    is_bound = resource.buffer->bindMemory(memory_block.allocation.memory, 0);
+                }
+                else
+                {
+                    is_bound = resource.texture->bindMemory(memory_block.allocation.memory, 0) &&
+                               resource.texture->createImageView();
+                }
+
+                if (!is_bound)
+                {
+                    ERROR("Failed to bind transient resource %s.", resource.name.c_str());
+                    return false;
+                }
+            }
+        }
+
+        INFO("Render graph: %zu transient resources in %zu memory blocks, %.2f MB instead of %.2f MB",
+             transient_indices.size(),
+             m_memory_blocks.size(),
+             m_transient_memory_size / (1024.0 * 1024.0),
+             unaliased_size / (1024.0 * 1024.0));
+        return true;
+    }
+
+    void RenderGraph::updateCulling()
+    {
+        // imported resources outlive the frame, so writing them is a result by itself
+        std::vector<bool> is_needed(m_resources.size());
+        for (uint32_t resource_index = 0; resource_index < m_resources.size(); ++resource_index)
+        {
+            const Resource& resource = m_resources[resource_index];
+            is_needed[resource_index] = !isTransient(resource) || resource.is_output;
+        }
+
+        for (auto it = m_passes.rbegin(); it != m_passes.rend(); ++it)
+        {
+            RenderGraphPass& pass = **it;
+            pass.m_is_culled      = std::none_of(
+                pass.m_writes.begin(), pass.m_writes.end(), [&](uint32_t index) { return is_needed[index]; });
+            if (pass.m_is_culled)
+            {
+                continue;
+            }
+
+            for (uint32_t resource_index : pass.m_reads)
+            {
+                is_needed[resource_index] = true;
+            }
+        }
+
+        // a transient resource takes over its memory right before the first pass that still runs uses it
+        std::vector<bool> is_acquired(m_resources.size());
+        for (auto& pass : m_passes)
+        {
+            pass->m_first_uses.clear();
+            if (pass->m_is_culled)
+            {
+                continue;
+            }
+
+            for (const std::vector<uint32_t>* resource_indices : {&pass->m_reads, &pass->m_writes})
+            {
+                for (uint32_t resource_index : *resource_indices)
+                {
+                    if (isTransient(m_resources[resource_index]) && !is_acquired[resource_index])
+                    {
+                        is_acquired[resource_index] = true;
+                        pass->m_first_uses.push_back(resource_index);
+                    }
+                }
+            }
+        }
+
+        // one submission per run of live passes on a queue, the tail gets its own so that the next frame does not
+        // wait for it
+        m_segments.clear();
+        for (uint32_t pass_index = 0; pass_index < m_passes.size(); ++pass_index)
+        {
+            const RenderGraphPass& pass = *m_passes[pass_index];
+            if (pass.m_is_culled)
+            {
+                continue;
+            }
+
+            if (m_segments.empty() || m_segments.back().queue_type != pass.m_queue_type ||
+                (m_segments.back().passes.front() < m_tail_begin && pass_index >= m_tail_begin))
+            {
+                m_segments.emplace_back();
+                m_segments.back().queue_type = pass.m_queue_type;
+            }
+            m_segments.back().passes.push_back(pass_index);
+        }
+
+        m_is_culling_dirty = false;
+    }
+
+    ResourceState& RenderGraph::getState(const Resource& resource)
+    {
+        return resource.buffer != nullptr ? resource.buffer->getState() : resource.texture->getState();
+    }
+
+    void RenderGraph::acquireQueue(uint32_t  resource_index,
+                                   QueueType queue_type,
+                                   uint64_t (&wait_values)[QUEUE_TYPE_COUNT])
+    {
+        Resource& resource = m_resources[resource_index];
+        if (resource.last_queue == queue_type)
+        {
+            return;
+        }
+
+        if (resource.last_value != 0)
+        {
+            uint64_t& wait_value = wait_values[static_cast<uint32_t>(resource.last_queue)];
+            wait_value           = std::max(wait_value, resource.last_value);
+        }
+
+        // the semaphore wait makes the writes of the other queue visible, the stages it tracked mean nothing here
+        ResourceState& state  = getState(resource);
+        VkImageLayout  layout = state.layout;
+        state                 = ResourceState();
+        state.layout          = layout;
+
+        resource.last_queue = queue_type;
+    }
+
+    void RenderGraph::acquireMemory(uint32_t  resource_index,
+                                    QueueType queue_type,
+                                    uint64_t (&wait_values)[QUEUE_TYPE_COUNT])
+    {
+        Resource&          resource     = m_resources[resource_index];
+        const MemoryBlock& memory_block = m_memory_blocks[resource.memory_block];
+        if (memory_block.resources.size() < 2)
+        {
+            return;
+        }
+
+        // the contents are discarded, the first access only has to wait for whoever touched the memory last. Which
+        // occupant that was depends on culling, waiting for all of them is always correct and rarely any wider.
+        ResourceState handoff;
+        for (uint32_t other_index : memory_block.resources)
+        {
+            if (other_index == resource_index)
+            {
+                continue;
+            }
+
+            const Resource& other = m_resources[other_index];
+            if (other.last_queue != queue_type)
+            {
+                uint64_t& wait_value = wait_values[static_cast<uint32_t>(other.last_queue)];
+                wait_value           = std::max(wait_value, other.last_value);
+                continue;
+            }
+
+            const ResourceState& other_state = getState(other);
+            handoff.write_stages |= other_state.write_stages | other_state.read_stages;
+            handoff.write_access |= other_state.write_access;
+        }
+
+        // UNDEFINED makes the next access of an image transition it, which is a write and waits for the handoff
+        getState(resource) = handoff;
+    }
+
+    bool RenderGraph::execute(FrameContext& frame)
+    {
+        if (!m_is_compiled)
+        {
+            ERROR("Render graph executed before it was compiled.");
+            return false;
+        }
+
+        if (m_is_culling_dirty)
+        {
+            updateCulling();
+        }
+
+        RHI& rhi = RHI::instance();
+
+        // uploads go to the graphics queue ahead of the frame, which orders them with the graphics segments. The
+        // other queues wait for them explicitly.
+        UploadContext& upload_context = UploadContext::instance();
+        if (!upload_context.flush())
+        {
+            return false;
+        }
+        uint64_t upload_value = upload_context.getPendingValue();
+
+        std::vector<uint32_t> segment_resources;
+        for (const Segment& segment : m_segments)
+        {
+            CommandBuffer* cmd = frame.beginCommandBuffer(segment.queue_type);
+            if (cmd == nullptr)
+            {
+                return false;
+            }
+
+            uint64_t wait_values[QUEUE_TYPE_COUNT] {};
+            if (segment.queue_type != QueueType::Graphics)
+            {
+                wait_values[static_cast<uint32_t>(QueueType::Graphics)] = upload_value;
+            }
+            segment_resources.clear();
+            for (uint32_t pass_index : segment.passes)
+            {
+                RenderGraphPass& pass = *m_passes[pass_index];
+                for (const std::vector<uint32_t>* resource_indices : {&pass.m_reads, &pass.m_writes})
+                {
+                    for (uint32_t resource_index : *resource_indices)
+                    {
+                        acquireQueue(resource_index, segment.queue_type, wait_values);
+                        segment_resources.push_back(resource_index);
+                    }
+                }
+
+                for (uint32_t resource_index : pass.m_first_uses)
+                {
+                    acquireMemory(resource_index, segment.queue_type, wait_values);
+                }
+                pass.m_record(*cmd);
+            }
+
+            // only other queues end up in wait_values, submissions to one queue execute in order
+            static_assert(QUEUE_TYPE_COUNT == 3, "one wait per queue type");
+            SemaphoreSubmit waits[QUEUE_TYPE_COUNT];
+            for (uint32_t queue_type = 0; queue_type < QUEUE_TYPE_COUNT; ++queue_type)
+            {
+                if (wait_values[queue_type] != 0)
+                {
+                    waits[queue_type].semaphore = rhi.getTimeline(static_cast<QueueType>(queue_type));
+                    waits[queue_type].value     = wait_values[queue_type];
+                }
+            }
+
+            uint64_t signal_value = 0;
+            bool     is_submitted = frame.submit(*cmd, {waits[0], waits[1], waits[2]}, signal_value);
+
+            // a failed submission still signals its value, so the next queue waiting on it cannot hang
+            if (signal_value != 0)
+            {
+                for (uint32_t resource_index : segment_resources)
+                {
+                    m_resources[resource_index].last_value = signal_value;
+                }
+            }
+
+            if (!is_submitted)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+} // namespace Nano
@@ -0,0 +1,166 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "render/rhi/memory_allocator.h"
+#include "render/rhi/rhi.h"
+
+namespace Nano
+{
+    class Buffer;
+    class Texture;
+    class RenderPass;
+    class RenderGraph;
+    class CommandBuffer;
+    class FrameContext;
+    struct ResourceState;
+
+    class RenderGraphPass
+    {
+    public:
+        RenderGraphPass& read(Buffer* buffer);
+        RenderGraphPass& read(Texture* texture);
+        RenderGraphPass& write(Buffer* buffer);
+        RenderGraphPass& write(Texture* texture);
+        // Declares every resource the render pass binds, storage outputs and cleared buffers as writes.
+        RenderGraphPass& use(const RenderPass& render_pass);
+        // Queue the pass records on, queues without a family of their own fall back to graphics.
+        RenderGraphPass& setQueue(QueueType queue_type);
+
+        const std::string& getName() const { return m_name; }
+        QueueType          getQueue() const { return m_queue_type; }
+        bool               isCulled() const { return m_is_culled; }
+
+    private:
+        friend class RenderGraph;
+
+        RenderGraph*                        m_graph {nullptr};
+        std::string                         m_name;
+        std::function<void(CommandBuffer&)> m_record;
+        std::vector<uint32_t>               m_reads;
+        std::vector<uint32_t>               m_writes;
+        std::vector<uint32_t>               m_first_uses; // transient resources this pass takes over the memory of
+        QueueType                           m_queue_type {QueueType::Graphics};
+        bool                                m_is_culled {false};
+    };
+
+    // Frame level scheduling of passes by the resources they read and write. Passes run in the order they are
+    // added and a read depends on the latest earlier write of the resource. Passes whose writes reach neither an
+    // imported resource nor an output are culled, and transient resources whose lifetimes don't overlap share
+    // memory. Barriers come from the resource state tracker as the passes record, the graph hands the tracked state
+    // of aliased memory from one transient resource over to the next.
+    //
+    // Consecutive passes on one queue are submitted together, a resource moving to another queue waits for the
+    // timeline value of the submission that used it last, in this frame or an earlier one. Passes behind the last
+    // graphics use of anything the other queues touch form the tail of the frame, the next frame's async work only
+    // waits for what comes before it.
+    class RenderGraph
+    {
+    public:
+        RenderGraph();
+        ~RenderGraph() noexcept;
+
+        RenderGraph(const RenderGraph&)                = delete;
+        RenderGraph& operator=(const RenderGraph&)     = delete;
+        RenderGraph(RenderGraph&&) noexcept            = delete;
+        RenderGraph& operator=(RenderGraph&&) noexcept = delete;
+
+        // Transient resources only live from the first to the last pass using them within a frame, their contents
+        // do not survive to the next one. Memory is bound by compile(), descriptors and views have to wait for it.
+        Buffer*  createBuffer(const char* name, VkBufferUsageFlags usage, size_t size);
+        Texture* createTexture(const char*       name,
+                               uint32_t          width,
+                               uint32_t          height,
+                               VkFormat          format,
+                               VkImageUsageFlags usage);
+
+        // Resources not created by the graph are imported, they persist across frames and writing them keeps a
+        // pass alive.
+        RenderGraphPass& addPass(const char* name, std::function<void(CommandBuffer&)> record);
+        // Records the render pass as configured and declares what it binds.
+        RenderGraphPass& addPass(RenderPass* render_pass);
+
+        // Transient resources something outside the graph consumes, e.g. a target that is presented.
+        void setOutput(Buffer* buffer, bool is_output);
+        void setOutput(Texture* texture, bool is_output);
+
+        // Computes lifetimes over all passes so that outputs can change later without moving memory, then aliases
+        // and binds the transient resources.
+        bool compile();
+        bool execute(FrameContext& frame);
+        void cleanup();
+
+        VkDeviceSize getTransientMemorySize() const { return m_transient_memory_size; }
+
+    private:
+        friend class RenderGraphPass;
+
+        static constexpr uint32_t INVALID_INDEX {0xFFFFFFFFu};
+
+        struct Resource
+        {
+            std::string              name;
+            Buffer*                  buffer {nullptr};
+            Texture*                 texture {nullptr};
+            std::unique_ptr<Buffer>  transient_buffer;
+            std::unique_ptr<Texture> transient_texture;
+            bool                     is_output {false};
+            uint32_t                 first_pass {INVALID_INDEX};
+            uint32_t                 last_pass {INVALID_INDEX};
+            uint32_t                 memory_block {INVALID_INDEX};
+            QueueType                last_queue {QueueType::Graphics};
+            uint64_t                 last_value {0}; // timeline value of last_queue, 0 => not submitted yet
+            bool                     is_async {false}; // used on a queue other than graphics
+            bool                     is_tail {false};  // used by a pass of the frame's tail
+        };
+
+        struct MemoryBlock
+        {
+            MemoryAllocation      allocation;
+            VkDeviceSize          size {0};
+            uint32_t              memory_type_bits {0};
+            std::vector<uint32_t> resources;
+        };
+
+        // Live passes submitted as one command buffer.
+        struct Segment
+        {
+            QueueType             queue_type {QueueType::Graphics};
+            std::vector<uint32_t> passes;
+        };
+
+        static bool isTransient(const Resource& resource)
+        {
+            return resource.transient_buffer != nullptr || resource.transient_texture != nullptr;
+        }
+
+        static ResourceState& getState(const Resource& resource);
+
+        uint32_t getResourceIndex(Buffer* buffer, Texture* texture);
+        bool     allocateMemoryBlocks();
+        void     updateQueues();
+        void     updateCulling();
+        // Both raise wait_values to the timeline values of other queues the segment has to wait for.
+        void acquireQueue(uint32_t resource_index, QueueType queue_type, uint64_t (&wait_values)[QUEUE_TYPE_COUNT]);
+        void acquireMemory(uint32_t resource_index, QueueType queue_type, uint64_t (&wait_values)[QUEUE_TYPE_COUNT]);
+
+        std::vector<Resource>                         m_resources;
+        std::unordered_map<const void*, uint32_t>     m_resource_indices;
+        std::vector<std::unique_ptr<RenderGraphPass>> m_passes;
+        std::vector<MemoryBlock>                      m_memory_blocks;
+        std::vector<Segment>                          m_segments;
+        uint32_t                                      m_tail_begin {0};
+        VkDeviceSize                                  m_transient_memory_size {0};
+        bool                                          m_is_compiled {false};
+        bool                                          m_is_culling_dirty {true};
+    };
+
+} // namespace Nano
+
+#endif // !RENDER_GRAPH_H
@@ -1,12 +1,17 @@
 #include "render_pass.h"
+#include <algorithm>
 #include <cstring>
 #include "misc/logger.h"
+#include "render/rhi/bindless_heap.h"
 #include "render/rhi/buffer.h"
 #include "render/rhi/command_buffer.h"
 #include "render/rhi/descriptor_set.h"
+#include "render/rhi/dynamic_buffer.h"
 #include "render/rhi/pipeline.h"
+#include "render/rhi/resource_state.h"
 #include "render/rhi/rhi.h"
 #include "render/rhi/shader.h"
+#include "render/rhi/shader_library.h"
 #include "render/rhi/texture.h"
 
 namespace Nano
@@ -40,9 +45,17 @@ namespace Nano
 
         m_descriptor_bindings.clear();
         m_buffers.clear();
+        m_output_buffers.clear();
         m_textures.clear();
         m_output_textures.clear();
         m_uniform_buffers.clear();
+        m_dynamic_uniform_buffers.clear();
+        m_clear_buffers.clear();
+        m_push_constant_size   = 0;
+        m_pipeline_source      = nullptr;
+        m_dispatch_args_buffer = nullptr;
+        m_draw_args_buffer     = nullptr;
+        m_draw_count_buffer    = nullptr;
     }
 
     void RenderPass::setComputeShader(const char* compute_shader_path)
@@ -53,14 +66,48 @@ namespace Nano
             return;
         }
 
-        m_compute_shader = std::make_unique<Shader>();
-        if (!m_compute_shader->loadFromFile(compute_shader_path))
+        m_compute_shader = ShaderLibrary::instance().load(compute_shader_path);
+        if (!m_compute_shader)
         {
             ERROR("Failed to load compute shader: %s", compute_shader_path);
             m_compute_shader.reset();
         }
     }
 
+    void RenderPass::sharePipeline(const RenderPass& source)
+    {
+        if (m_type != RenderPassType::Compute || source.m_type != RenderPassType::Compute)
+        {
+            ERROR("Only compute render passes can share a pipeline.");
+            return;
+        }
+
+        m_compute_shader.reset();
+        m_pipeline_source = &source;
+    }
+
+    bool RenderPass::isLayoutCompatible(const RenderPass& other) const
+    {
+        if (m_push_constant_size != other.m_push_constant_size ||
+            m_descriptor_bindings.size() != other.m_descriptor_bindings.size())
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < m_descriptor_bindings.size(); ++i)
+        {
+            const VkDescriptorSetLayoutBinding& binding       = m_descriptor_bindings[i];
+            const VkDescriptorSetLayoutBinding& other_binding = other.m_descriptor_bindings[i];
+            if (binding.binding != other_binding.binding || binding.descriptorType != other_binding.descriptorType ||
+                binding.descriptorCount != other_binding.descriptorCount ||
+                binding.stageFlags != other_binding.stageFlags)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
     void RenderPass::setGraphicsShaders(const char* vertex_shader_path, const char* fragment_shader_path)
     {
         if (m_type != RenderPassType::Graphics)
@@ -69,23 +116,23 @@ namespace Nano
             return;
         }
 
-        m_vertex_shader = std::make_unique<Shader>();
-        if (!m_vertex_shader->loadFromFile(vertex_shader_path))
+        m_vertex_shader = ShaderLibrary::instance().load(vertex_shader_path);
+        if (!m_vertex_shader)
         {
             ERROR("Failed to load vertex shader: %s", vertex_shader_path);
             m_vertex_shader.reset();
             return;
         }
 
-        m_fragment_shader = std::make_unique<Shader>();
-        if (!m_fragment_shader->loadFromFile(fragment_shader_path))
+        m_fragment_shader = ShaderLibrary::instance().load(fragment_shader_path);
+        if (!m_fragment_shader)
         {
             ERROR("Failed to load fragment shader: %s", fragment_shader_path);
             m_fragment_shader.reset();
         }
     }
 
-    void RenderPass::bindResource(uint32_t binding, Buffer* buffer, VkDescriptorType type)
+    void RenderPass::bindResource(uint32_t binding, Buffer* buffer, VkDescriptorType type, bool is_output)
     {
         if (buffer == nullptr)
         {
@@ -108,6 +155,10 @@ namespace Nano
         else
         {
             m_buffers.push_back(buffer);
+            if (is_output)
+            {
+                m_output_buffers.push_back(buffer);
+            }
         }
     }
 
@@ -151,6 +202,68 @@ namespace Nano
         m_uniform_buffers.push_back(buffer);
     }
 
+    void RenderPass::setDynamicUniformBuffer(uint32_t        binding,
+                                             DynamicBuffer*  buffer,
+                                             VkDeviceSize    range,
+                                             const uint32_t* offset)
+    {
+        if (buffer == nullptr || offset == nullptr)
+        {
+            ERROR("Cannot set null dynamic uniform buffer to render pass.");
+            return;
+        }
+
+        if (m_dynamic_uniform_buffers.size() >= MAX_DYNAMIC_UNIFORM_BUFFERS)
+        {
+            ERROR("Too many dynamic uniform buffers in render pass %s.", m_name.c_str());
+            return;
+        }
+
+        VkDescriptorSetLayoutBinding layout_binding = {};
+        layout_binding.binding                      = binding;
+        layout_binding.descriptorCount              = 1;
+        layout_binding.descriptorType               = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        layout_binding.stageFlags                   = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+        m_descriptor_bindings.push_back(layout_binding);
+
+        // dynamic offsets are passed in binding order
+        auto it = m_dynamic_uniform_buffers.begin();
+        while (it != m_dynamic_uniform_buffers.end() && it->binding < binding)
+        {
+            ++it;
+        }
+        m_dynamic_uniform_buffers.insert(it, {binding, buffer->getBuffer(), range, offset});
+    }
+
+    bool RenderPass::writeDynamicUniformBuffers()
+    {
+        for (const DynamicUniformBuffer& dynamic_uniform_buffer : m_dynamic_uniform_buffers)
+        {
+            if (!m_descriptor_set->updateBuffer(dynamic_uniform_buffer.binding,
+                                                dynamic_uniform_buffer.buffer,
+                                                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                                                dynamic_uniform_buffer.range))
+            {
+                ERROR("Failed to update dynamic uniform buffer binding %u in render pass %s.",
+                      dynamic_uniform_buffer.binding,
+                      m_name.c_str());
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    uint32_t RenderPass::getDynamicOffsets(uint32_t (&out_offsets)[MAX_DYNAMIC_UNIFORM_BUFFERS]) const
+    {
+        uint32_t offset_count = 0;
+        for (const DynamicUniformBuffer& dynamic_uniform_buffer : m_dynamic_uniform_buffers)
+        {
+            out_offsets[offset_count++] = *dynamic_uniform_buffer.offset;
+        }
+        return offset_count;
+    }
+
     void RenderPass::setComputeDispatchArgs(uint32_t x, uint32_t y, uint32_t z)
     {
         m_dispatch_x = x;
@@ -158,9 +271,77 @@ namespace Nano
         m_dispatch_z = z;
     }
 
+    void RenderPass::setComputeDispatchIndirect(Buffer* args_buffer, VkDeviceSize offset)
+    {
+        if (m_type != RenderPassType::Compute)
+        {
+            ERROR("Cannot set indirect dispatch args for graphics render pass.");
+            return;
+        }
+
+        m_dispatch_args_buffer = args_buffer;
+        m_dispatch_args_offset = offset;
+    }
+
+    void RenderPass::addClearBuffer(Buffer* buffer)
+    {
+        if (buffer == nullptr)
+        {
+            ERROR("Cannot clear null buffer in render pass.");
+            return;
+        }
+
+        m_clear_buffers.push_back(buffer);
+    }
+
+    void RenderPass::setPushConstants(const void* data, uint32_t size)
+    {
+        if (data == nullptr || size == 0 || size % 4 != 0 || size > MAX_PUSH_CONSTANT_SIZE)
+        {
+            ERROR("Invalid push constants of %u bytes for render pass %s.", size, m_name.c_str());
+            return;
+        }
+
+        // the pipeline layout only covers the range declared when it was built
+        if (m_pipeline && size > m_push_constant_size)
+        {
+            ERROR("Push constants of render pass %s cannot grow after build().", m_name.c_str());
+            return;
+        }
+
+        std::memcpy(m_push_constants, data, size);
+        m_push_constant_size = std::max(m_push_constant_size, size);
+    }
+
+    void RenderPass::getPushConstantRanges(std::vector<VkPushConstantRange>& ranges) const
+    {
+        if (m_push_constant_size > 0)
+        {
+            ranges.push_back({getPushConstantStages(), 0, m_push_constant_size});
+        }
+    }
+
+    void RenderPass::recordPushConstants(VkCommandBuffer cmd) const
+    {
+        if (m_push_constant_size > 0)
+        {
+            vkCmdPushConstants(
+                cmd, m_pipeline->getLayout(), getPushConstantStages(), 0, m_push_constant_size, m_push_constants);
+        }
+    }
+
+    VkShaderStageFlags RenderPass::getPushConstantStages() const
+    {
+        if (m_type == RenderPassType::Compute)
+        {
+            return VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        return VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
     bool RenderPass::buildCompute()
     {
-        if (!m_compute_shader)
+        if (!m_compute_shader && m_pipeline_source == nullptr)
         {
             ERROR("Compute shader not set for compute render pass.");
             return false;
@@ -172,11 +353,32 @@ namespace Nano
             return false;
         }
 
-        m_descriptor_set_layout = std::make_unique<DescriptorSetLayout>();
-        if (!m_descriptor_set_layout->create(m_descriptor_bindings))
+        if (m_pipeline_source != nullptr)
         {
-            ERROR("Failed to create descriptor set layout for compute render pass.");
-            return false;
+            if (!m_pipeline_source->m_pipeline)
+            {
+                ERROR("Render pass %s shares the pipeline of %s, which is not built yet.",
+                      m_name.c_str(),
+                      m_pipeline_source->m_name.c_str());
+                return false;
+            }
+            if (!isLayoutCompatible(*m_pipeline_source))
+            {
+                ERROR("Render pass %s does not bind the layout of %s, whose pipeline it shares.",
+                      m_name.c_str(),
+                      m_pipeline_source->m_name.c_str());
+                return false;
+            }
+            m_descriptor_set_layout = m_pipeline_source->m_descriptor_set_layout;
+        }
+        else
+        {
+            m_descriptor_set_layout = std::make_shared<DescriptorSetLayout>();
+            if (!m_descriptor_set_layout->create(m_descriptor_bindings))
+            {
+                ERROR("Failed to create descriptor set layout for compute render pass.");
+                return false;
+            }
         }
 
         std::vector<VkDescriptorPoolSize> pool_sizes;
@@ -184,6 +386,11 @@ namespace Nano
         {
             pool_sizes.push_back({VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, static_cast<uint32_t>(m_uniform_buffers.size())});
         }
+        if (!m_dynamic_uniform_buffers.empty())
+        {
+            pool_sizes.push_back({VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                                  static_cast<uint32_t>(m_dynamic_uniform_buffers.size())});
+        }
         if (!m_textures.empty())
         {
             pool_sizes.push_back({VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, static_cast<uint32_t>(m_textures.size())});
@@ -258,11 +465,24 @@ namespace Nano
             }
         }
 
+        if (!writeDynamicUniformBuffers())
+        {
+            return false;
+        }
+
+        if (m_pipeline_source != nullptr)
+        {
+            m_pipeline = m_pipeline_source->m_pipeline;
+            return true;
+        }
+
         ComputePipelineCreateInfo pipeline_info = {};
         pipeline_info.compute_shader            = m_compute_shader->getModule();
         pipeline_info.descriptor_set_layout     = m_descriptor_set_layout->getLayout();
+        pipeline_info.bindless_set_layout       = BindlessHeap::instance().getLayout();
+        getPushConstantRanges(pipeline_info.push_constant_ranges);
 
-        m_pipeline = std::make_unique<Pipeline>();
+        m_pipeline = std::make_shared<Pipeline>();
         if (!m_pipeline->createComputePipeline(pipeline_info))
         {
             ERROR("Failed to create compute pipeline for render pass.");
@@ -290,7 +510,7 @@ namespace Nano
 
         if (!m_descriptor_bindings.empty())
         {
-            m_descriptor_set_layout = std::make_unique<DescriptorSetLayout>();
+            m_descriptor_set_layout = std::make_shared<DescriptorSetLayout>();
             if (!m_descriptor_set_layout->create(m_descriptor_bindings))
             {
                 ERROR("Failed to create descriptor set layout for graphics render pass.");
@@ -303,6 +523,11 @@ namespace Nano
                 pool_sizes.push_back(
                     {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, static_cast<uint32_t>(m_uniform_buffers.size())});
             }
+            if (!m_dynamic_uniform_buffers.empty())
+            {
+                pool_sizes.push_back({VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                                      static_cast<uint32_t>(m_dynamic_uniform_buffers.size())});
+            }
             if (!m_textures.empty())
             {
                 pool_sizes.push_back({VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, static_cast<uint32_t>(m_textures.size())});
@@ -373,6 +598,11 @@ namespace Nano
                         }
                     }
                 }
+
+                if (!writeDynamicUniformBuffers())
+                {
+                    return false;
+                }
             }
         }
 
@@ -419,9 +649,11 @@ namespace Nano
         if (m_descriptor_set_layout)
         {
             pipeline_info.descriptor_set_layout = m_descriptor_set_layout->getLayout();
+            pipeline_info.bindless_set_layout   = BindlessHeap::instance().getLayout();
         }
+        getPushConstantRanges(pipeline_info.push_constant_ranges);
 
-        m_pipeline = std::make_unique<Pipeline>();
+        m_pipeline = std::make_shared<Pipeline>();
         if (!m_pipeline->createGraphicsPipeline(pipeline_info))
         {
             ERROR("Failed to create graphics pipeline for render pass.");
@@ -443,150 +675,163 @@ namespace Nano
         }
     }
 
-    void RenderPass::executeCompute()
+    VkPipelineStageFlags2KHR RenderPass::getShaderStages() const
     {
-        RHI& rhi = RHI::instance();
+        if (m_type == RenderPassType::Compute)
+        {
+            return VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR;
+        }
+        return VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR;
+    }
 
-        CommandBuffer cmd;
-        if (!cmd.create())
+    void RenderPass::getAccesses(std::vector<ResourceAccess>& accesses) const
+    {
+        VkPipelineStageFlags2KHR shader_stages = getShaderStages();
+
+        for (Buffer* uniform_buffer : m_uniform_buffers)
         {
-            ERROR("Failed to create command buffer for compute render pass execution.");
-            return;
+            accesses.push_back(
+                {uniform_buffer, nullptr, VK_IMAGE_LAYOUT_UNDEFINED, shader_stages, VK_ACCESS_2_UNIFORM_READ_BIT_KHR});
         }
 
-        if (!cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT))
+        // outputs are appended to with atomics, so they are read as well
+        for (Buffer* buffer : m_buffers)
         {
-            ERROR("Failed to begin command buffer for compute render pass execution.");
-            return;
+            VkAccessFlags2KHR access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR;
+            if (std::find(m_output_buffers.begin(), m_output_buffers.end(), buffer) != m_output_buffers.end())
+            {
+                access |= VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR;
+            }
+            accesses.push_back({buffer, nullptr, VK_IMAGE_LAYOUT_UNDEFINED, shader_stages, access});
         }
 
-        for (Texture* output_texture : m_output_textures)
-        {
-            VkImageSubresourceRange range = {};
-            range.aspectMask              = VK_IMAGE_ASPECT_COLOR_BIT;
-            range.baseMipLevel            = 0;
-            range.levelCount              = 1;
-            range.baseArrayLayer          = 0;
-            range.layerCount              = 1;
-
-            VkImageMemoryBarrier barrier = {};
-            barrier.sType                = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-            barrier.oldLayout            = VK_IMAGE_LAYOUT_UNDEFINED;
-            barrier.newLayout            = VK_IMAGE_LAYOUT_GENERAL;
-            barrier.srcQueueFamilyIndex  = VK_QUEUE_FAMILY_IGNORED;
-            barrier.dstQueueFamilyIndex  = VK_QUEUE_FAMILY_IGNORED;
-            barrier.image                = output_texture->getImage();
-            barrier.srcAccessMask        = 0;
-            barrier.dstAccessMask        = VK_ACCESS_SHADER_WRITE_BIT;
-            barrier.subresourceRange     = range;
-
-            vkCmdPipelineBarrier(cmd.getCommandBuffer(),
-                                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-                                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-                                 0,
-                                 0,
-                                 nullptr,
-                                 0,
-                                 nullptr,
-                                 1,
-                                 &barrier);
-        }
-
-        vkCmdBindPipeline(cmd.getCommandBuffer(), VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline->getPipeline());
+        for (Texture* texture : m_textures)
+        {
+            VkAccessFlags2KHR access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR;
+            if (std::find(m_output_textures.begin(), m_output_textures.end(), texture) != m_output_textures.end())
+            {
+                access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR;
+            }
+            accesses.push_back({nullptr, texture, VK_IMAGE_LAYOUT_GENERAL, shader_stages, access});
+        }
+
+        for (Buffer* args_buffer : {m_dispatch_args_buffer, m_draw_args_buffer, m_draw_count_buffer})
+        {
+            if (args_buffer != nullptr)
+            {
+                accesses.push_back({args_buffer,
+                                    nullptr,
+                                    VK_IMAGE_LAYOUT_UNDEFINED,
+                                    VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT_KHR,
+                                    VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT_KHR});
+            }
+        }
+    }
+
+    void RenderPass::recordBarriers(VkCommandBuffer cmd)
+    {
+        std::vector<ResourceAccess> accesses;
+        getAccesses(accesses);
+
+        BarrierBatch barriers;
+        for (const ResourceAccess& access : accesses)
+        {
+            barriers.access(access);
+        }
+        barriers.flush(cmd);
+    }
+
+    void RenderPass::recordCompute(VkCommandBuffer cmd)
+    {
+        if (!m_clear_buffers.empty())
+        {
+            BarrierBatch barriers;
+            for (Buffer* buffer : m_clear_buffers)
+            {
+                barriers.access(buffer, VK_PIPELINE_STAGE_2_CLEAR_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR);
+            }
+            barriers.flush(cmd);
+
+            for (Buffer* buffer : m_clear_buffers)
+            {
+                vkCmdFillBuffer(cmd, buffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+            }
+        }
+
+        recordBarriers(cmd);
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline->getPipeline());
 
         if (m_descriptor_set)
         {
             VkDescriptorSet descriptor_set = m_descriptor_set->getDescriptorSet();
-            vkCmdBindDescriptorSets(cmd.getCommandBuffer(),
+            uint32_t        dynamic_offsets[MAX_DYNAMIC_UNIFORM_BUFFERS];
+            uint32_t        dynamic_offset_count = getDynamicOffsets(dynamic_offsets);
+            vkCmdBindDescriptorSets(cmd,
                                     VK_PIPELINE_BIND_POINT_COMPUTE,
                                     m_pipeline->getLayout(),
                                     0,
                                     1,
                                     &descriptor_set,
-                                    0,
-                                    nullptr);
-        }
-
-        vkCmdDispatch(cmd.getCommandBuffer(), m_dispatch_x, m_dispatch_y, m_dispatch_z);
-
-        for (Texture* output_texture : m_output_textures)
-        {
-            VkImageSubresourceRange range = {};
-            range.aspectMask              = VK_IMAGE_ASPECT_COLOR_BIT;
-            range.baseMipLevel            = 0;
-            range.levelCount              = 1;
-            range.baseArrayLayer          = 0;
-            range.layerCount              = 1;
-
-            VkImageMemoryBarrier barrier = {};
-            barrier.sType                = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-            barrier.oldLayout            = VK_IMAGE_LAYOUT_GENERAL;
-            barrier.newLayout            = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcQueueFamilyIndex  = VK_QUEUE_FAMILY_IGNORED;
-            barrier.dstQueueFamilyIndex  = VK_QUEUE_FAMILY_IGNORED;
-            barrier.image                = output_texture->getImage();
-            barrier.srcAccessMask        = VK_ACCESS_SHADER_WRITE_BIT;
-            barrier.dstAccessMask        = VK_ACCESS_SHADER_READ_BIT;
-            barrier.subresourceRange     = range;
-
-            vkCmdPipelineBarrier(cmd.getCommandBuffer(),
-                                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-                                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-                                 0,
-                                 0,
-                                 nullptr,
-                                 0,
-                                 nullptr,
-                                 1,
-                                 &barrier);
+                                    dynamic_offset_count,
+                                    dynamic_offsets);
+            BindlessHeap::instance().bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline->getLayout());
         }
 
-        if (!cmd.end())
+        recordPushConstants(cmd);
+
+        if (m_dispatch_args_buffer != nullptr)
         {
-            ERROR("Failed to end command buffer for compute render pass execution.");
-            return;
+            vkCmdDispatchIndirect(cmd, m_dispatch_args_buffer->getBuffer(), m_dispatch_args_offset);
         }
+        else
+        {
+            vkCmdDispatch(cmd, m_dispatch_x, m_dispatch_y, m_dispatch_z);
+        }
+    }
 
-        VkFence           fence;
-        VkFenceCreateInfo fence_info = {};
-        fence_info.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fence_info.flags             = 0;
-        vkCreateFence(rhi.getDevice(), &fence_info, nullptr, &fence);
+    void RenderPass::executeCompute()
+    {
+        RHI& rhi = RHI::instance();
 
-        if (!cmd.submit(
-                rhi.getGraphicsQueue(), VK_NULL_HANDLE, VK_NULL_HANDLE, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, fence))
+        CommandBuffer cmd;
+        if (!cmd.create())
         {
-            vkDestroyFence(rhi.getDevice(), fence, nullptr);
-            ERROR("Failed to submit command buffer for compute render pass execution.");
+            ERROR("Failed to create command buffer for compute render pass execution.");
             return;
         }
 
-        if (vkWaitForFences(rhi.getDevice(), 1, &fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+        if (!cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT))
         {
-            vkDestroyFence(rhi.getDevice(), fence, nullptr);
-            ERROR("Failed to wait for compute render pass execution to complete.");
+            ERROR("Failed to begin command buffer for compute render pass execution.");
             return;
         }
 
-        vkDestroyFence(rhi.getDevice(), fence, nullptr);
-    }
+        recordCompute(cmd.getCommandBuffer());
 
-    void RenderPass::executeGraphics()
-    {
-        RHI& rhi = RHI::instance();
+        if (!cmd.end())
+        {
+            ERROR("Failed to end command buffer for compute render pass execution.");
+            return;
+        }
 
-        CommandBuffer cmd;
-        if (!cmd.create())
+        uint64_t signal_value = 0;
+        if (!cmd.submitTimeline(signal_value))
         {
-            ERROR("Failed to create command buffer for graphics render pass execution.");
+            ERROR("Failed to submit command buffer for compute render pass execution.");
             return;
         }
 
-        if (!cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT))
+        if (!rhi.waitTimelineValue(rhi.getGraphicsTimeline(), signal_value))
         {
-            ERROR("Failed to begin command buffer for graphics render pass execution.");
+            ERROR("Failed to wait for compute render pass execution to complete.");
             return;
         }
+    }
+
+    void RenderPass::recordGraphics(VkCommandBuffer cmd)
+    {
+        recordBarriers(cmd);
 
         if (m_framebuffer != VK_NULL_HANDLE)
         {
@@ -603,57 +848,91 @@ namespace Nano
             render_pass_info.clearValueCount       = 2;
             render_pass_info.pClearValues          = clear_values;
 
-            vkCmdBeginRenderPass(cmd.getCommandBuffer(), &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+            vkCmdBeginRenderPass(cmd, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
         }
 
-        vkCmdBindPipeline(cmd.getCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->getPipeline());
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->getPipeline());
 
         if (m_descriptor_set)
         {
             VkDescriptorSet descriptor_set = m_descriptor_set->getDescriptorSet();
-            vkCmdBindDescriptorSets(cmd.getCommandBuffer(),
+            uint32_t        dynamic_offsets[MAX_DYNAMIC_UNIFORM_BUFFERS];
+            uint32_t        dynamic_offset_count = getDynamicOffsets(dynamic_offsets);
+            vkCmdBindDescriptorSets(cmd,
                                     VK_PIPELINE_BIND_POINT_GRAPHICS,
                                     m_pipeline->getLayout(),
                                     0,
                                     1,
                                     &descriptor_set,
-                                    0,
-                                    nullptr);
+                                    dynamic_offset_count,
+                                    dynamic_offsets);
+            BindlessHeap::instance().bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->getLayout());
+        }
+
+        recordPushConstants(cmd);
+
+        if (m_draw_args_buffer != nullptr)
+        {
+            if (m_draw_count_buffer != nullptr)
+            {
+                vkCmdDrawIndirectCount(cmd,
+                                       m_draw_args_buffer->getBuffer(),
+                                       m_draw_args_offset,
+                                       m_draw_count_buffer->getBuffer(),
+                                       m_draw_count_offset,
+                                       m_max_draw_count,
+                                       m_draw_args_stride);
+            }
+            else
+            {
+                vkCmdDrawIndirect(
+                    cmd, m_draw_args_buffer->getBuffer(), m_draw_args_offset, m_max_draw_count, m_draw_args_stride);
+            }
         }
 
         if (m_framebuffer != VK_NULL_HANDLE)
         {
-            vkCmdEndRenderPass(cmd.getCommandBuffer());
+            vkCmdEndRenderPass(cmd);
+        }
+    }
+
+    void RenderPass::executeGraphics()
+    {
+        RHI& rhi = RHI::instance();
+
+        CommandBuffer cmd;
+        if (!cmd.create())
+        {
+            ERROR("Failed to create command buffer for graphics render pass execution.");
+            return;
         }
 
+        if (!cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT))
+        {
+            ERROR("Failed to begin command buffer for graphics render pass execution.");
+            return;
+        }
+
+        recordGraphics(cmd.getCommandBuffer());
+
         if (!cmd.end())
         {
             ERROR("Failed to end command buffer for graphics render pass execution.");
             return;
         }
 
-        VkFence           fence;
-        VkFenceCreateInfo fence_info = {};
-        fence_info.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fence_info.flags             = 0;
-        vkCreateFence(rhi.getDevice(), &fence_info, nullptr, &fence);
-
-        if (!cmd.submit(
-                rhi.getGraphicsQueue(), VK_NULL_HANDLE, VK_NULL_HANDLE, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, fence))
+        uint64_t signal_value = 0;
+        if (!cmd.submitTimeline(signal_value))
         {
-            vkDestroyFence(rhi.getDevice(), fence, nullptr);
             ERROR("Failed to submit command buffer for graphics render pass execution.");
             return;
         }
 
-        if (vkWaitForFences(rhi.getDevice(), 1, &fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+        if (!rhi.waitTimelineValue(rhi.getGraphicsTimeline(), signal_value))
         {
-            vkDestroyFence(rhi.getDevice(), fence, nullptr);
             ERROR("Failed to wait for graphics render pass execution to complete.");
             return;
         }
-
-        vkDestroyFence(rhi.getDevice(), fence, nullptr);
     }
 
     void RenderPass::execute()
@@ -668,103 +947,66 @@ namespace Nano
         }
     }
 
-    void RenderPass::executeIndirect(Buffer* indirect_buffer)
+    void RenderPass::record(CommandBuffer& cmd)
     {
-        if (m_type != RenderPassType::Graphics)
-        {
-            ERROR("executeIndirect can only be called on graphics render pass.");
-            return;
-        }
-
-        if (indirect_buffer == nullptr)
+        if (!cmd.isRecording())
         {
-            ERROR("Cannot execute indirect draw with null buffer.");
+            ERROR("Cannot record render pass %s into a command buffer that is not recording.", m_name.c_str());
             return;
         }
 
-        RHI& rhi = RHI::instance();
-
-        CommandBuffer cmd;
-        if (!cmd.create())
-        {
-            ERROR("Failed to create command buffer for indirect render pass execution.");
-            return;
-        }
-
-        if (!cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT))
-        {
-            ERROR("Failed to begin command buffer for indirect render pass execution.");
-            return;
-        }
-
-        if (m_framebuffer != VK_NULL_HANDLE)
-        {
-            VkClearValue clear_values[2] = {};
-            clear_values[0].color        = {{0.0f, 0.0f, 0.0f, 1.0f}};
-            clear_values[1].depthStencil = {1.0f, 0};
-
-            VkRenderPassBeginInfo render_pass_info = {};
-            render_pass_info.sType                 = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            render_pass_info.renderPass            = m_render_pass;
-            render_pass_info.framebuffer           = m_framebuffer;
-            render_pass_info.renderArea.offset     = {0, 0};
-            render_pass_info.renderArea.extent     = {m_viewport_width, m_viewport_height};
-            render_pass_info.clearValueCount       = 2;
-            render_pass_info.pClearValues          = clear_values;
-
-            vkCmdBeginRenderPass(cmd.getCommandBuffer(), &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
-        }
-
-        vkCmdBindPipeline(cmd.getCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->getPipeline());
-
-        if (m_descriptor_set)
+        if (m_type == RenderPassType::Compute)
         {
-            VkDescriptorSet descriptor_set = m_descriptor_set->getDescriptorSet();
-            vkCmdBindDescriptorSets(cmd.getCommandBuffer(),
-                                    VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                    m_pipeline->getLayout(),
-                                    0,
-                                    1,
-                                    &descriptor_set,
-                                    0,
-                                    nullptr);
+            recordCompute(cmd.getCommandBuffer());
         }
-
-        vkCmdDrawIndirect(cmd.getCommandBuffer(), indirect_buffer->getBuffer(), 0, 1, 16);
-
-        if (m_framebuffer != VK_NULL_HANDLE)
+        else
         {
-            vkCmdEndRenderPass(cmd.getCommandBuffer());
+            recordGraphics(cmd.getCommandBuffer());
         }
+    }
 
-        if (!cmd.end())
+    void RenderPass::setDrawIndirect(Buffer*      args_buffer,
+                                     VkDeviceSize offset,
+                                     uint32_t     max_draw_count,
+                                     uint32_t     stride,
+                                     Buffer*      count_buffer,
+                                     VkDeviceSize count_offset)
+    {
+        if (m_type != RenderPassType::Graphics)
         {
-            ERROR("Failed to end command buffer for indirect render pass execution.");
+            ERROR("Cannot set indirect draw args for compute render pass.");
             return;
         }
 
-        VkFence           fence;
-        VkFenceCreateInfo fence_info = {};
-        fence_info.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fence_info.flags             = 0;
-        vkCreateFence(rhi.getDevice(), &fence_info, nullptr, &fence);
+        m_draw_args_buffer  = args_buffer;
+        m_draw_args_offset  = offset;
+        m_max_draw_count    = max_draw_count;
+        m_draw_args_stride  = stride;
+        m_draw_count_buffer = count_buffer;
+        m_draw_count_offset = count_offset;
+    }
 
-        if (!cmd.submit(
-                rhi.getGraphicsQueue(), VK_NULL_HANDLE, VK_NULL_HANDLE, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, fence))
+    void RenderPass::executeIndirect(Buffer*      indirect_buffer,
+                                     VkDeviceSize offset,
+                                     uint32_t     max_draw_count,
+                                     uint32_t     stride,
+                                     Buffer*      count_buffer,
+                                     VkDeviceSize count_offset)
+    {
+        if (m_type != RenderPassType::Graphics)
         {
-            vkDestroyFence(rhi.getDevice(), fence, nullptr);
-            ERROR("Failed to submit command buffer for indirect render pass execution.");
+            ERROR("executeIndirect can only be called on graphics render pass.");
             return;
         }
 
-        if (vkWaitForFences(rhi.getDevice(), 1, &fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+        if (indirect_buffer == nullptr)
         {
-            vkDestroyFence(rhi.getDevice(), fence, nullptr);
-            ERROR("Failed to wait for indirect render pass execution to complete.");
+            ERROR("Cannot execute indirect draw with null buffer.");
             return;
         }
 
-        vkDestroyFence(rhi.getDevice(), fence, nullptr);
+        setDrawIndirect(indirect_buffer, offset, max_draw_count, stride, count_buffer, count_offset);
+        executeGraphics();
     }
 
 } // namespace Nano
@@ -6,6 +6,7 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include "render/rhi/resource_state.h"
 
 namespace Nano
 {
@@ -14,6 +15,7 @@ namespace Nano
     class DescriptorSet;
     class DescriptorSetLayout;
     class Buffer;
+    class DynamicBuffer;
     class Texture;
     class CommandBuffer;
 
@@ -35,52 +37,135 @@ namespace Nano
         RenderPass& operator=(RenderPass&&) noexcept = delete;
 
         void setComputeShader(const char* compute_shader_path);
+        // Dispatches the pipeline of another compute pass instead of loading a shader and building one of its own,
+        // only the resources bound differ. source must be built first and bind the same bindings and push constants.
+        void sharePipeline(const RenderPass& source);
         void setGraphicsShaders(const char* vertex_shader_path, const char* fragment_shader_path);
 
-        void bindResource(uint32_t binding, Buffer* buffer, VkDescriptorType type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        // Storage buffers not marked as output are only read, record() derives the barriers of the pass from that.
+        void bindResource(uint32_t         binding,
+                          Buffer*          buffer,
+                          VkDescriptorType type      = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                          bool             is_output = false);
         void bindResource(uint32_t         binding,
                           Texture*         texture,
                           VkDescriptorType type      = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
                           bool             is_output = false);
 
         void setUniformBuffer(uint32_t binding, Buffer* buffer);
+        // Binds range bytes of a DynamicBuffer as VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC. The dynamic offset is read
+        // from *offset whenever the pass records, so its owner can move the window every frame.
+        void
+        setDynamicUniformBuffer(uint32_t binding, DynamicBuffer* buffer, VkDeviceSize range, const uint32_t* offset);
         void setComputeDispatchArgs(uint32_t x, uint32_t y, uint32_t z);
+        // Takes the group counts from a VkDispatchIndirectCommand written by an earlier pass.
+        void setComputeDispatchIndirect(Buffer* args_buffer, VkDeviceSize offset = 0);
+        // Zeroes the buffer right before the dispatch, e.g. counters the pass appends to.
+        void addClearBuffer(Buffer* buffer);
+        // Small per-dispatch arguments, pushed with every dispatch or draw the pass records. build() sizes the push
+        // constant range from the data set so far, afterwards the data can change every record() but not grow.
+        void setPushConstants(const void* data, uint32_t size);
+        template<typename T>
+        void setPushConstants(const T& data)
+        {
+            setPushConstants(&data, sizeof(T));
+        }
 
         bool build(uint32_t canvas_width = 0, uint32_t canvas_height = 0);
         void execute();
-        void executeIndirect(Buffer* indirect_buffer);
+        // Records the pass into a caller-owned command buffer instead of submitting it on its own, graphics passes
+        // record the draw configured by setDrawIndirect().
+        void record(CommandBuffer& cmd);
+        // Draws from GPU written VkDrawIndirectCommand records. With a count buffer the draw count is read from
+        // it (vkCmdDrawIndirectCount) and max_draw_count only bounds it.
+        void setDrawIndirect(Buffer*      args_buffer,
+                             VkDeviceSize offset         = 0,
+                             uint32_t     max_draw_count = 1,
+                             uint32_t     stride         = sizeof(VkDrawIndirectCommand),
+                             Buffer*      count_buffer   = nullptr,
+                             VkDeviceSize count_offset   = 0);
+        void executeIndirect(Buffer*      indirect_buffer,
+                             VkDeviceSize offset         = 0,
+                             uint32_t     max_draw_count = 1,
+                             uint32_t     stride         = sizeof(VkDrawIndirectCommand),
+                             Buffer*      count_buffer   = nullptr,
+                             VkDeviceSize count_offset   = 0);
+
+        // Every resource the pass binds or takes indirect args from, with the stages and accesses record() syncs.
+        void getAccesses(std::vector<ResourceAccess>& accesses) const;
+
+        const std::vector<Buffer*>& getClearBuffers() const { return m_clear_buffers; }
 
         RenderPassType     getType() const { return m_type; }
         const std::string& getName() const { return m_name; }
 
     private:
+        static constexpr uint32_t MAX_DYNAMIC_UNIFORM_BUFFERS {4};
+        static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE {128}; // the minimum maxPushConstantsSize
+
+        struct DynamicUniformBuffer
+        {
+            uint32_t        binding {0};
+            Buffer*         buffer {nullptr};
+            VkDeviceSize    range {0};
+            const uint32_t* offset {nullptr};
+        };
+
         void cleanup();
         bool buildCompute();
         bool buildGraphics(uint32_t canvas_width, uint32_t canvas_height);
+        bool writeDynamicUniformBuffers();
         void executeCompute();
+        void recordCompute(VkCommandBuffer cmd);
         void executeGraphics();
+        void recordGraphics(VkCommandBuffer cmd);
+        void recordBarriers(VkCommandBuffer cmd);
+        uint32_t getDynamicOffsets(uint32_t (&out_offsets)[MAX_DYNAMIC_UNIFORM_BUFFERS]) const;
+        void     getPushConstantRanges(std::vector<VkPushConstantRange>& ranges) const;
+        void     recordPushConstants(VkCommandBuffer cmd) const;
+        VkShaderStageFlags       getPushConstantStages() const;
+        VkPipelineStageFlags2KHR getShaderStages() const;
+        bool                     isLayoutCompatible(const RenderPass& other) const;
 
         RenderPassType m_type;
         std::string    m_name;
 
-        std::unique_ptr<Shader> m_compute_shader;
-        std::unique_ptr<Shader> m_vertex_shader;
-        std::unique_ptr<Shader> m_fragment_shader;
+        std::shared_ptr<Shader> m_compute_shader;
+        std::shared_ptr<Shader> m_vertex_shader;
+        std::shared_ptr<Shader> m_fragment_shader;
 
-        std::unique_ptr<Pipeline>            m_pipeline;
-        std::unique_ptr<DescriptorSetLayout> m_descriptor_set_layout;
+        // shared with the passes that sharePipeline() this one
+        std::shared_ptr<Pipeline>            m_pipeline;
+        std::shared_ptr<DescriptorSetLayout> m_descriptor_set_layout;
         std::unique_ptr<DescriptorSet>       m_descriptor_set;
+        const RenderPass*                    m_pipeline_source {nullptr};
 
         std::vector<VkDescriptorSetLayoutBinding> m_descriptor_bindings;
         std::vector<Buffer*>                      m_buffers;
+        std::vector<Buffer*>                      m_output_buffers;
         std::vector<Texture*>                     m_textures;
         std::vector<Texture*>                     m_output_textures;
         std::vector<Buffer*>                      m_uniform_buffers;
+        std::vector<DynamicUniformBuffer>         m_dynamic_uniform_buffers; // by binding, the order of the offsets
+
+        uint8_t  m_push_constants[MAX_PUSH_CONSTANT_SIZE] {};
+        uint32_t m_push_constant_size {0};
 
         uint32_t m_dispatch_x {1};
         uint32_t m_dispatch_y {1};
         uint32_t m_dispatch_z {1};
 
+        Buffer*              m_dispatch_args_buffer {nullptr};
+        VkDeviceSize         m_dispatch_args_offset {0};
+        std::vector<Buffer*> m_clear_buffers;
+
+        Buffer*      m_draw_args_buffer {nullptr};
+        VkDeviceSize m_draw_args_offset {0};
+        uint32_t     m_max_draw_count {1};
+        uint32_t     m_draw_args_stride {sizeof(VkDrawIndirectCommand)};
+        Buffer*      m_draw_count_buffer {nullptr};
+        VkDeviceSize m_draw_count_offset {0};
+
         uint32_t m_viewport_width {0};
         uint32_t m_viewport_height {0};
 
@@ -0,0 +1,295 @@
+#include "bindless_heap.h"
+#include <algorithm>
+#include "misc/logger.h"
+#include "rhi.h"
+
+namespace Nano
+{
+    static const VkDescriptorType BINDLESS_DESCRIPTOR_TYPES[BINDLESS_SLOT_COUNT] = {
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        VK_DESCRIPTOR_TYPE_SAMPLER,
+    };
+
+    BindlessHeap::BindlessHeap()
+    {
+        if (!RHI::instance().isBindless())
+            return;
+
+        if (!init())
+        {
+            WARN("Failed to create bindless heap, passes keep to their own descriptor sets.");
+        }
+    }
+
+    BindlessHeap::~BindlessHeap() noexcept
+    {
+        RHI& rhi = RHI::instance();
+        if (rhi.getDevice() == VK_NULL_HANDLE)
+            return;
+
+        // destroying the pool frees the set
+        if (m_pool != VK_NULL_HANDLE)
+        {
+            vkDestroyDescriptorPool(rhi.getDevice(), m_pool, nullptr);
+            m_pool = VK_NULL_HANDLE;
+            m_set  = VK_NULL_HANDLE;
+        }
+
+        if (m_layout != VK_NULL_HANDLE)
+        {
+            vkDestroyDescriptorSetLayout(rhi.getDevice(), m_layout, nullptr);
+            m_layout = VK_NULL_HANDLE;
+            DEBUG("  Destroyed bindless heap");
+        }
+    }
+
+    bool BindlessHeap::init()
+    {
+        RHI& rhi = RHI::instance();
+
+        VkPhysicalDeviceDescriptorIndexingProperties indexing_props = {};
+        indexing_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 device_props = {};
+        device_props.sType                       = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        device_props.pNext                       = &indexing_props;
+        vkGetPhysicalDeviceProperties2(rhi.getPhysicalDevice(), &device_props);
+
+        // the set holds every array at once, so each has to stay within the per stage limits as well
+        uint32_t max_resources = indexing_props.maxPerStageUpdateAfterBindResources;
+        m_slots[static_cast<uint32_t>(BindlessSlot::StorageBuffer)].capacity =
+            std::min({MAX_STORAGE_BUFFERS,
+                      indexing_props.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                      indexing_props.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+        m_slots[static_cast<uint32_t>(BindlessSlot::SampledImage)].capacity =
+            std::min({MAX_SAMPLED_IMAGES,
+                      indexing_props.maxDescriptorSetUpdateAfterBindSampledImages,
+                      indexing_props.maxPerStageDescriptorUpdateAfterBindSampledImages});
+        m_slots[static_cast<uint32_t>(BindlessSlot::StorageImage)].capacity =
+            std::min({MAX_STORAGE_IMAGES,
+                      indexing_props.maxDescriptorSetUpdateAfterBindStorageImages,
+                      indexing_props.maxPerStageDescriptorUpdateAfterBindStorageImages});
+        m_slots[static_cast<uint32_t>(BindlessSlot::Sampler)].capacity =
+            std::min({MAX_SAMPLERS,
+                      indexing_props.maxDescriptorSetUpdateAfterBindSamplers,
+                      indexing_props.maxPerStageDescriptorUpdateAfterBindSamplers});
+
+        uint32_t total_count = 0;
+        for (const Slot& slot : m_slots)
+        {
+            total_count += slot.capacity;
+        }
+        if (total_count > max_resources)
+        {
+            for (Slot& slot : m_slots)
+            {
+                uint64_t capacity = static_cast<uint64_t>(slot.capacity) * max_resources / total_count;
+                slot.capacity     = static_cast<uint32_t>(capacity);
+            }
+        }
+
+        VkDescriptorSetLayoutBinding bindings[BINDLESS_SLOT_COUNT]      = {};
+        VkDescriptorBindingFlags     binding_flags[BINDLESS_SLOT_COUNT] = {};
+        VkDescriptorPoolSize         pool_sizes[BINDLESS_SLOT_COUNT]    = {};
+        for (uint32_t slot = 0; slot < BINDLESS_SLOT_COUNT; ++slot)
+        {
+            bindings[slot].binding         = slot;
+            bindings[slot].descriptorType  = BINDLESS_DESCRIPTOR_TYPES[slot];
+            bindings[slot].descriptorCount = m_slots[slot].capacity;
+            bindings[slot].stageFlags      = VK_SHADER_STAGE_ALL;
+
+            // indices are written while frames using others are in flight, and most of each array stays empty
+            binding_flags[slot] = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                  VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+                                  VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+
+            pool_sizes[slot] = {BINDLESS_DESCRIPTOR_TYPES[slot], m_slots[slot].capacity};
+        }
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info = {};
+        binding_flags_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        binding_flags_info.bindingCount  = BINDLESS_SLOT_COUNT;
+        binding_flags_info.pBindingFlags = binding_flags;
+
+        VkDescriptorSetLayoutCreateInfo layout_info = {};
+        layout_info.sType                           = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layout_info.pNext                           = &binding_flags_info;
+        layout_info.flags                           = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        layout_info.bindingCount                    = BINDLESS_SLOT_COUNT;
+        layout_info.pBindings                       = bindings;
+
+        if (vkCreateDescriptorSetLayout(rhi.getDevice(), &layout_info, nullptr, &m_layout) != VK_SUCCESS)
+        {
+            ERROR("Failed to create bindless descriptor set layout.");
+            return false;
+        }
+
+        VkDescriptorPoolCreateInfo pool_info = {};
+        pool_info.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.flags                      = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+        pool_info.maxSets                    = 1;
+        pool_info.poolSizeCount              = BINDLESS_SLOT_COUNT;
+        pool_info.pPoolSizes                 = pool_sizes;
+
+        if (vkCreateDescriptorPool(rhi.getDevice(), &pool_info, nullptr, &m_pool) != VK_SUCCESS)
+        {
+            ERROR("Failed to create bindless descriptor pool.");
+            return false;
+        }
+
+        VkDescriptorSetAllocateInfo alloc_info = {};
+        alloc_info.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorPool              = m_pool;
+        alloc_info.descriptorSetCount          = 1;
+        alloc_info.pSetLayouts                 = &m_layout;
+
+        if (vkAllocateDescriptorSets(rhi.getDevice(), &alloc_info, &m_set) != VK_SUCCESS)
+        {
+            ERROR("Failed to allocate bindless descriptor set.");
+            m_set = VK_NULL_HANDLE;
+            return false;
+        }
+
+        INFO("Bindless heap: %u storage buffers, %u sampled images, %u storage images, %u samplers",
+             m_slots[0].capacity,
+             m_slots[1].capacity,
+             m_slots[2].capacity,
+             m_slots[3].capacity);
+        return true;
+    }
+
+    uint32_t BindlessHeap::acquireIndex(BindlessSlot slot)
+    {
+        Slot& heap_slot = m_slots[static_cast<uint32_t>(slot)];
+
+        if (!heap_slot.free_indices.empty())
+        {
+            uint32_t index = heap_slot.free_indices.back();
+            heap_slot.free_indices.pop_back();
+            return index;
+        }
+
+        if (heap_slot.next_index >= heap_slot.capacity)
+        {
+            ERROR("Bindless heap binding %u is full.", static_cast<uint32_t>(slot));
+            return INVALID_INDEX;
+        }
+
+        return heap_slot.next_index++;
+    }
+
+    void BindlessHeap::write(BindlessSlot                  slot,
+                             uint32_t                      index,
+                             const VkDescriptorBufferInfo* buffer_info,
+                             const VkDescriptorImageInfo*  image_info)
+    {
+        VkWriteDescriptorSet descriptor_write = {};
+        descriptor_write.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_write.dstSet               = m_set;
+        descriptor_write.dstBinding           = static_cast<uint32_t>(slot);
+        descriptor_write.dstArrayElement      = index;
+        descriptor_write.descriptorType       = BINDLESS_DESCRIPTOR_TYPES[static_cast<uint32_t>(slot)];
+        descriptor_write.descriptorCount      = 1;
+        descriptor_write.pBufferInfo          = buffer_info;
+        descriptor_write.pImageInfo           = image_info;
+
+        vkUpdateDescriptorSets(RHI::instance().getDevice(), 1, &descriptor_write, 0, nullptr);
+    }
+
+    uint32_t BindlessHeap::registerBuffer(VkBuffer buffer, VkDeviceSize size)
+    {
+        if (!isEnabled() || buffer == VK_NULL_HANDLE)
+            return INVALID_INDEX;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        uint32_t index = acquireIndex(BindlessSlot::StorageBuffer);
+        if (index == INVALID_INDEX)
+            return INVALID_INDEX;
+
+        VkDescriptorBufferInfo buffer_info = {};
+        buffer_info.buffer                 = buffer;
+        buffer_info.offset                 = 0;
+        buffer_info.range                  = size;
+        write(BindlessSlot::StorageBuffer, index, &buffer_info, nullptr);
+
+        return index;
+    }
+
+    uint32_t BindlessHeap::registerSampledImage(VkImageView image_view, VkImageLayout image_layout)
+    {
+        if (!isEnabled() || image_view == VK_NULL_HANDLE)
+            return INVALID_INDEX;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        uint32_t index = acquireIndex(BindlessSlot::SampledImage);
+        if (index == INVALID_INDEX)
+            return INVALID_INDEX;
+
+        VkDescriptorImageInfo image_info = {};
+        image_info.imageLayout           = image_layout;
+        image_info.imageView             = image_view;
+        write(BindlessSlot::SampledImage, index, nullptr, &image_info);
+
+        return index;
+    }
+
+    uint32_t BindlessHeap::registerStorageImage(VkImageView image_view)
+    {
+        if (!isEnabled() || image_view == VK_NULL_HANDLE)
+            return INVALID_INDEX;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        uint32_t index = acquireIndex(BindlessSlot::StorageImage);
+        if (index == INVALID_INDEX)
+            return INVALID_INDEX;
+
+        VkDescriptorImageInfo image_info = {};
+        image_info.imageLayout           = VK_IMAGE_LAYOUT_GENERAL;
+        image_info.imageView             = image_view;
+        write(BindlessSlot::StorageImage, index, nullptr, &image_info);
+
+        return index;
+    }
+
+    uint32_t BindlessHeap::registerSampler(VkSampler sampler)
+    {
+        if (!isEnabled() || sampler == VK_NULL_HANDLE)
+            return INVALID_INDEX;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        uint32_t index = acquireIndex(BindlessSlot::Sampler);
+        if (index == INVALID_INDEX)
+            return INVALID_INDEX;
+
+        VkDescriptorImageInfo image_info = {};
+        image_info.sampler               = sampler;
+        write(BindlessSlot::Sampler, index, nullptr, &image_info);
+
+        return index;
+    }
+
+    void BindlessHeap::release(BindlessSlot slot, uint32_t index)
+    {
+        if (!isEnabled() || index == INVALID_INDEX)
+            return;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // the stale descriptor stays behind, partially bound arrays allow it as long as no shader reads it
+        m_slots[static_cast<uint32_t>(slot)].free_indices.push_back(index);
+    }
+
+    void BindlessHeap::bind(VkCommandBuffer cmd, VkPipelineBindPoint bind_point, VkPipelineLayout pipeline_layout) const
+    {
+        if (!isEnabled())
+            return;
+
+        vkCmdBindDescriptorSets(cmd, bind_point, pipeline_layout, SET_INDEX, 1, &m_set, 0, nullptr);
+    }
+
+} // namespace Nano
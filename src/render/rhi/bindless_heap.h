@@ -0,0 +1,96 @@
+#ifndef BINDLESS_HEAP_H
+#define BINDLESS_HEAP_H
+
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Nano
+{
+    // Bindings of the heap's set, shaders/Bindless.glsl declares the matching arrays.
+    enum class BindlessSlot : uint32_t
+    {
+        StorageBuffer,
+        SampledImage,
+        StorageImage,
+        Sampler,
+    };
+
+    static constexpr uint32_t BINDLESS_SLOT_COUNT {4};
+
+    // One global update-after-bind descriptor set with an array per BindlessSlot, shaders address resources by
+    // index instead of through a set of their own. Only exists when RHI::isBindless(), Buffer and Texture register
+    // themselves on creation then. Pipelines that use it take getLayout() as set SET_INDEX.
+    //
+    // A released index is handed out again right away, which is safe because its resource must not be destroyed
+    // while the GPU still uses it in the first place.
+    class BindlessHeap final
+    {
+    public:
+        static BindlessHeap& instance()
+        {
+            static BindlessHeap s_bindless_heap;
+            return s_bindless_heap;
+        }
+
+        static constexpr uint32_t SET_INDEX {1};
+        static constexpr uint32_t INVALID_INDEX {UINT32_MAX};
+
+        bool isEnabled() const { return m_set != VK_NULL_HANDLE; }
+
+        // INVALID_INDEX when the heap is disabled or its array is full.
+        uint32_t registerBuffer(VkBuffer buffer, VkDeviceSize size = VK_WHOLE_SIZE);
+        uint32_t registerSampledImage(VkImageView image_view,
+                                      VkImageLayout image_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        uint32_t registerStorageImage(VkImageView image_view);
+        // Samplers stay owned by the caller, they are not registered automatically.
+        uint32_t registerSampler(VkSampler sampler);
+        void     release(BindlessSlot slot, uint32_t index);
+
+        VkDescriptorSetLayout getLayout() const { return m_layout; }
+        VkDescriptorSet       getDescriptorSet() const { return m_set; }
+        uint32_t getCapacity(BindlessSlot slot) const { return m_slots[static_cast<uint32_t>(slot)].capacity; }
+
+        // Binds the heap as SET_INDEX of a pipeline layout created with getLayout().
+        void bind(VkCommandBuffer cmd, VkPipelineBindPoint bind_point, VkPipelineLayout pipeline_layout) const;
+
+    protected:
+        BindlessHeap();
+        ~BindlessHeap() noexcept;
+
+        BindlessHeap(const BindlessHeap&)            = delete;
+        BindlessHeap& operator=(const BindlessHeap&) = delete;
+        BindlessHeap(BindlessHeap&&)                 = delete;
+        BindlessHeap& operator=(BindlessHeap&&)      = delete;
+
+    private:
+        static constexpr uint32_t MAX_STORAGE_BUFFERS {16384};
+        static constexpr uint32_t MAX_SAMPLED_IMAGES {16384};
+        static constexpr uint32_t MAX_STORAGE_IMAGES {4096};
+        static constexpr uint32_t MAX_SAMPLERS {256};
+
+        struct Slot
+        {
+            uint32_t              capacity {0};
+            uint32_t              next_index {0}; // never handed out before
+            std::vector<uint32_t> free_indices;
+        };
+
+        bool     init();
+        uint32_t acquireIndex(BindlessSlot slot);
+        void     write(BindlessSlot                  slot,
+                       uint32_t                      index,
+                       const VkDescriptorBufferInfo* buffer_info,
+                       const VkDescriptorImageInfo*  image_info);
+
+        std::mutex            m_mutex;
+        VkDescriptorSetLayout m_layout {VK_NULL_HANDLE};
+        VkDescriptorPool      m_pool {VK_NULL_HANDLE};
+        VkDescriptorSet       m_set {VK_NULL_HANDLE};
+        Slot                  m_slots[BINDLESS_SLOT_COUNT];
+    };
+
+} // namespace Nano
+
+#endif // !BINDLESS_HEAP_H
@@ -1,7 +1,10 @@
 #include "buffer.h"
 #include <cstring>
+#include "bindless_heap.h"
+#include "memory_allocator.h"
 #include "misc/logger.h"
 #include "rhi.h"
+#include "upload_context.h"
 
 namespace Nano
 {
@@ -18,6 +21,12 @@ namespace Nano
             unmap();
         }
 
+        if (m_bindless_index != BindlessHeap::INVALID_INDEX)
+        {
+            BindlessHeap::instance().release(BindlessSlot::StorageBuffer, m_bindless_index);
+            m_bindless_index = BindlessHeap::INVALID_INDEX;
+        }
+
         if (m_buffer != VK_NULL_HANDLE)
         {
             vkDestroyBuffer(rhi.getDevice(), m_buffer, nullptr);
@@ -25,17 +34,32 @@ namespace Nano
             DEBUG("  Destroyed buffer");
         }
 
-        if (m_memory != VK_NULL_HANDLE)
+        if (m_allocation.memory != VK_NULL_HANDLE)
         {
-            vkFreeMemory(rhi.getDevice(), m_memory, nullptr);
-            m_memory = VK_NULL_HANDLE;
+            MemoryAllocator::instance().free(m_allocation);
             DEBUG("  Released buffer memory");
         }
 
-        m_size = 0;
+        m_size  = 0;
+        m_state = {};
     }
 
     bool Buffer::create(VkBufferUsageFlags usage, size_t size, VkMemoryPropertyFlags memory_property_flags)
+    {
+        if (!createUnbound(usage, size))
+        {
+            return false;
+        }
+
+        if (!allocateMemory(memory_property_flags))
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    bool Buffer::createUnbound(VkBufferUsageFlags usage, size_t size)
     {
         RHI& rhi = RHI::instance();
 
@@ -45,7 +69,8 @@ namespace Nano
             return false;
         }
 
-        m_size = size;
+        m_size  = size;
+        m_usage = usage;
 
         VkBufferCreateInfo buffer_create_info = {};
         buffer_create_info.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -53,20 +78,45 @@ namespace Nano
         buffer_create_info.usage              = usage;
         buffer_create_info.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
 
+        // culling buffers move between the graphics and the async compute queue every frame
+        const std::vector<uint32_t>& queue_family_indices = rhi.getSharedQueueFamilyIndices();
+        if (queue_family_indices.size() > 1)
+        {
+            buffer_create_info.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+            buffer_create_info.queueFamilyIndexCount = static_cast<uint32_t>(queue_family_indices.size());
+            buffer_create_info.pQueueFamilyIndices   = queue_family_indices.data();
+        }
+
         if (vkCreateBuffer(rhi.getDevice(), &buffer_create_info, nullptr, &m_buffer) != VK_SUCCESS)
         {
             ERROR("Failed to create buffer.");
             return false;
         }
 
-        if (!allocateMemory(memory_property_flags))
+        return true;
+    }
+
+    bool Buffer::bindMemory(VkDeviceMemory memory, VkDeviceSize offset)
+    {
+        RHI& rhi = RHI::instance();
+
+        if (vkBindBufferMemory(rhi.getDevice(), m_buffer, memory, offset) != VK_SUCCESS)
         {
+            ERROR("Failed to bind buffer memory.");
             return false;
         }
 
+        registerBindless();
         return true;
     }
 
+    VkMemoryRequirements Buffer::getMemoryRequirements() const
+    {
+        VkMemoryRequirements mem_requirements = {};
+        vkGetBufferMemoryRequirements(RHI::instance().getDevice(), m_buffer, &mem_requirements);
+        return mem_requirements;
+    }
+
     bool Buffer::allocateMemory(VkMemoryPropertyFlags memory_property_flags)
     {
         RHI& rhi = RHI::instance();
@@ -74,33 +124,32 @@ namespace Nano
         VkMemoryRequirements mem_requirements;
         vkGetBufferMemoryRequirements(rhi.getDevice(), m_buffer, &mem_requirements);
 
-        uint32_t memory_type_index = 0;
-        if (!rhi.findMemoryType(mem_requirements.memoryTypeBits, memory_property_flags, memory_type_index))
-        {
-            ERROR("Failed to find suitable memory type for buffer.");
-            return false;
-        }
-
-        VkMemoryAllocateInfo vkMemoryAllocInfo = {};
-        vkMemoryAllocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        vkMemoryAllocInfo.allocationSize       = mem_requirements.size;
-        vkMemoryAllocInfo.memoryTypeIndex      = memory_type_index;
-
-        if (vkAllocateMemory(rhi.getDevice(), &vkMemoryAllocInfo, nullptr, &m_memory) != VK_SUCCESS)
+        if (!MemoryAllocator::instance().allocate(
+                mem_requirements, memory_property_flags, MemoryResourceKind::Linear, m_allocation))
         {
             ERROR("Failed to allocate buffer memory.");
             return false;
         }
 
-        if (vkBindBufferMemory(rhi.getDevice(), m_buffer, m_memory, 0) != VK_SUCCESS)
+        if (vkBindBufferMemory(rhi.getDevice(), m_buffer, m_allocation.memory, m_allocation.offset) != VK_SUCCESS)
         {
             ERROR("Failed to bind buffer memory.");
             return false;
         }
 
+        registerBindless();
         return true;
     }
 
+    void Buffer::registerBindless()
+    {
+        // a descriptor may only point at a buffer with memory bound
+        if ((m_usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) && m_bindless_index == BindlessHeap::INVALID_INDEX)
+        {
+            m_bindless_index = BindlessHeap::instance().registerBuffer(m_buffer, m_size);
+        }
+    }
+
     bool Buffer::uploadData(const void* data, size_t size)
     {
         if (size > m_size)
@@ -109,6 +158,12 @@ namespace Nano
             return false;
         }
 
+        // device local memory can't be written by the host, the copy goes through the staging ring
+        if (m_allocation.mapped == nullptr)
+        {
+            return UploadContext::instance().uploadBuffer(this, data, size);
+        }
+
         void* mapped_data = map();
         if (mapped_data == nullptr)
         {
@@ -129,17 +184,15 @@ namespace Nano
             return nullptr;
         }
 
-        RHI& rhi = RHI::instance();
-
-        void* mapped_data = nullptr;
-        if (vkMapMemory(rhi.getDevice(), m_memory, 0, m_size, 0, &mapped_data) != VK_SUCCESS)
+        // the allocator keeps host visible memory mapped, mapping only hands out the pointer
+        if (m_allocation.mapped == nullptr)
         {
-            ERROR("Failed to map buffer memory.");
+            ERROR("Failed to map buffer memory, it is not host visible.");
             return nullptr;
         }
 
         m_is_mapped = true;
-        return mapped_data;
+        return m_allocation.mapped;
     }
 
     void Buffer::unmap()
@@ -149,8 +202,6 @@ namespace Nano
             return;
         }
 
-        RHI& rhi = RHI::instance();
-        vkUnmapMemory(rhi.getDevice(), m_memory);
         m_is_mapped = false;
     }
 
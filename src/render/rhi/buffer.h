@@ -2,6 +2,9 @@
 #define BUFFER_H
 
 #include <vulkan/vulkan_core.h>
+#include "bindless_heap.h"
+#include "memory_allocator.h"
+#include "resource_state.h"
 
 namespace Nano
 {
@@ -19,6 +22,12 @@ namespace Nano
         bool create(VkBufferUsageFlags    usage,
                     size_t                size,
                     VkMemoryPropertyFlags memory_property_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        // Creates the buffer without memory, bindMemory() attaches memory owned by someone else, e.g. a RenderGraph
+        // aliasing it with other transient resources.
+        bool createUnbound(VkBufferUsageFlags usage, size_t size);
+        bool bindMemory(VkDeviceMemory memory, VkDeviceSize offset);
+        // Host visible buffers are written in place. Device local ones need VK_BUFFER_USAGE_TRANSFER_DST_BIT, their
+        // copy is queued on the UploadContext and lands with its next flush.
         bool uploadData(const void* data, size_t size);
 
         void* map();
@@ -26,15 +35,26 @@ namespace Nano
 
         VkBuffer getBuffer() const { return m_buffer; }
         size_t   getSize() const { return m_size; }
+        // Index into the bindless heap's storage buffers, BindlessHeap::INVALID_INDEX without storage usage or heap.
+        uint32_t getBindlessIndex() const { return m_bindless_index; }
+
+        VkMemoryRequirements getMemoryRequirements() const;
+
+        // Last GPU access, kept up to date by BarrierBatch.
+        ResourceState& getState() { return m_state; }
 
     private:
         bool allocateMemory(VkMemoryPropertyFlags memory_property_flags);
+        void registerBindless();
         void cleanup();
 
-        VkBuffer       m_buffer {VK_NULL_HANDLE};
-        VkDeviceMemory m_memory {VK_NULL_HANDLE};
-        size_t         m_size {0};
-        bool           m_is_mapped {false};
+        VkBuffer           m_buffer {VK_NULL_HANDLE};
+        MemoryAllocation   m_allocation; // empty when bindMemory() attached someone else's memory
+        size_t             m_size {0};
+        VkBufferUsageFlags m_usage {0};
+        uint32_t           m_bindless_index {BindlessHeap::INVALID_INDEX};
+        bool               m_is_mapped {false};
+        ResourceState      m_state;
     };
 
 } // namespace Nano
@@ -0,0 +1,172 @@
+#include "command_allocator.h"
+#include "misc/logger.h"
+#include "rhi.h"
+
+namespace Nano
+{
+    // pools are destroyed through the device, so make sure the RHI singleton outlives this one
+    CommandAllocator::CommandAllocator() { RHI::instance(); }
+
+    CommandAllocator::~CommandAllocator() noexcept
+    {
+        RHI& rhi = RHI::instance();
+        if (rhi.getDevice() == VK_NULL_HANDLE)
+            return;
+
+        vkDeviceWaitIdle(rhi.getDevice());
+
+        // destroying a pool frees every buffer allocated from it
+        for (auto& thread_pools : m_thread_pools)
+        {
+            for (auto& slot_pools : thread_pools.second.slots)
+            {
+                for (CommandPool& slot : slot_pools)
+                {
+                    if (slot.pool != VK_NULL_HANDLE)
+                    {
+                        vkDestroyCommandPool(rhi.getDevice(), slot.pool, nullptr);
+                        slot.pool = VK_NULL_HANDLE;
+                    }
+                }
+            }
+        }
+        m_thread_pools.clear();
+
+        DEBUG("  Destroyed command pools");
+    }
+
+    void CommandAllocator::beginFrame(uint32_t frame_slot)
+    {
+        RHI& rhi = RHI::instance();
+
+        if (frame_slot >= FRAME_SLOT_COUNT)
+        {
+            ERROR("Invalid frame slot %u.", frame_slot);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (auto& thread_pools : m_thread_pools)
+        {
+            for (CommandPool& slot : thread_pools.second.slots[frame_slot])
+            {
+                if (slot.pool != VK_NULL_HANDLE)
+                {
+                    vkResetCommandPool(rhi.getDevice(), slot.pool, 0);
+                }
+            }
+        }
+
+        m_frame_slot = frame_slot;
+    }
+
+    VkCommandBuffer CommandAllocator::acquire(VkCommandBufferLevel level,
+                                              uint32_t             frame_slot,
+                                              QueueType            queue_type,
+                                              VkCommandPool&       out_pool)
+    {
+        RHI& rhi = RHI::instance();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (frame_slot == CURRENT_FRAME_SLOT)
+        {
+            frame_slot = m_frame_slot;
+        }
+
+        if (frame_slot > PERSISTENT_SLOT)
+        {
+            ERROR("Invalid frame slot %u.", frame_slot);
+            return VK_NULL_HANDLE;
+        }
+
+        CommandPool& slot =
+            m_thread_pools[std::this_thread::get_id()].slots[frame_slot][static_cast<uint32_t>(queue_type)];
+        if (slot.pool == VK_NULL_HANDLE)
+        {
+            // buffers can still be reset one by one, e.g. a long lived buffer recorded every frame
+            VkCommandPoolCreateInfo pool_info = {};
+            pool_info.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            pool_info.flags                   = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+            pool_info.queueFamilyIndex        = rhi.getQueueFamilyIndex(queue_type);
+
+            if (vkCreateCommandPool(rhi.getDevice(), &pool_info, nullptr, &slot.pool) != VK_SUCCESS)
+            {
+                ERROR("Failed to create command pool.");
+                return VK_NULL_HANDLE;
+            }
+        }
+
+        out_pool = slot.pool;
+
+        std::vector<VkCommandBuffer>& free_list =
+            level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? slot.free_primary : slot.free_secondary;
+        if (!free_list.empty())
+        {
+            VkCommandBuffer command_buffer = free_list.back();
+            free_list.pop_back();
+            return command_buffer;
+        }
+
+        VkCommandBufferAllocateInfo alloc_info = {};
+        alloc_info.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.commandPool                 = slot.pool;
+        alloc_info.level                       = level;
+        alloc_info.commandBufferCount          = 1;
+
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        if (vkAllocateCommandBuffers(rhi.getDevice(), &alloc_info, &command_buffer) != VK_SUCCESS)
+        {
+            ERROR("Failed to allocate command buffer.");
+            return VK_NULL_HANDLE;
+        }
+
+        return command_buffer;
+    }
+
+    void CommandAllocator::release(VkCommandPool pool, VkCommandBuffer command_buffer, VkCommandBufferLevel level)
+    {
+        if (command_buffer == VK_NULL_HANDLE)
+            return;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        CommandPool* slot = findPool(pool);
+        if (slot == nullptr)
+        {
+            ERROR("Released command buffer does not belong to any command pool.");
+            return;
+        }
+
+        // vkBeginCommandBuffer resets it implicitly on reuse
+        if (level == VK_COMMAND_BUFFER_LEVEL_PRIMARY)
+        {
+            slot->free_primary.push_back(command_buffer);
+        }
+        else
+        {
+            slot->free_secondary.push_back(command_buffer);
+        }
+    }
+
+    CommandAllocator::CommandPool* CommandAllocator::findPool(VkCommandPool pool)
+    {
+        for (auto& thread_pools : m_thread_pools)
+        {
+            for (auto& slot_pools : thread_pools.second.slots)
+            {
+                for (CommandPool& slot : slot_pools)
+                {
+                    if (slot.pool == pool)
+                    {
+                        return &slot;
+                    }
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
+} // namespace Nano
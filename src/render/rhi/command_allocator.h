@@ -0,0 +1,76 @@
+#ifndef COMMAND_ALLOCATOR_H
+#define COMMAND_ALLOCATOR_H
+
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "rhi.h"
+
+namespace Nano
+{
+    // Owns one VkCommandPool per recording thread, frame slot and queue type and recycles the command buffers
+    // allocated from them. Buffers go back to their pool with release(), and beginFrame() resets all pools of a slot
+    // at once.
+    class CommandAllocator final
+    {
+    public:
+        static CommandAllocator& instance()
+        {
+            static CommandAllocator s_command_allocator;
+            return s_command_allocator;
+        }
+
+        static constexpr uint32_t FRAME_SLOT_COUNT {2};
+        static constexpr uint32_t CURRENT_FRAME_SLOT {0xFFFFFFFFu};
+        // Never reset by beginFrame(), for buffers that stay pending across frames. They are reset one by one when
+        // they are begun again after release().
+        static constexpr uint32_t PERSISTENT_SLOT {FRAME_SLOT_COUNT};
+
+        // Resets the pools of the slot on every thread, so the GPU must be done with the slot and no thread may be
+        // recording into it. acquire() calls without an explicit slot use this one afterwards.
+        void beginFrame(uint32_t frame_slot);
+
+        // Takes a released buffer from the calling thread's pool of the slot or allocates a new one. It can only be
+        // submitted to queues of the family queue_type maps to.
+        VkCommandBuffer
+        acquire(VkCommandBufferLevel level, uint32_t frame_slot, QueueType queue_type, VkCommandPool& out_pool);
+        // The buffer must not be pending execution anymore.
+        void release(VkCommandPool pool, VkCommandBuffer command_buffer, VkCommandBufferLevel level);
+
+        uint32_t getFrameSlot() const { return m_frame_slot; }
+
+    protected:
+        CommandAllocator();
+        ~CommandAllocator() noexcept;
+
+        CommandAllocator(const CommandAllocator&)            = delete;
+        CommandAllocator& operator=(const CommandAllocator&) = delete;
+        CommandAllocator(CommandAllocator&&)                 = delete;
+        CommandAllocator& operator=(CommandAllocator&&)      = delete;
+
+    private:
+        struct CommandPool
+        {
+            VkCommandPool                pool {VK_NULL_HANDLE};
+            std::vector<VkCommandBuffer> free_primary;
+            std::vector<VkCommandBuffer> free_secondary;
+        };
+
+        struct ThreadCommandPools
+        {
+            CommandPool slots[FRAME_SLOT_COUNT + 1][QUEUE_TYPE_COUNT]; // the frame slots and the persistent one
+        };
+
+        CommandPool* findPool(VkCommandPool pool);
+
+        std::mutex                                              m_mutex;
+        std::unordered_map<std::thread::id, ThreadCommandPools> m_thread_pools;
+        uint32_t                                                m_frame_slot {0};
+    };
+
+} // namespace Nano
+
+#endif // !COMMAND_ALLOCATOR_H
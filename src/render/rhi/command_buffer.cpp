@@ -10,67 +10,35 @@ namespace Nano
 
     void CommandBuffer::cleanup()
     {
-        RHI& rhi = RHI::instance();
-
-        if (m_command_buffer != VK_NULL_HANDLE && m_command_pool != VK_NULL_HANDLE)
-        {
-            vkFreeCommandBuffers(rhi.getDevice(), m_command_pool, 1, &m_command_buffer);
-            m_command_buffer = VK_NULL_HANDLE;
-
-            DEBUG("  Freed command buffer");
-        }
-
-        if (m_command_pool != VK_NULL_HANDLE)
+        if (m_command_buffer != VK_NULL_HANDLE)
         {
-            vkDestroyCommandPool(rhi.getDevice(), m_command_pool, nullptr);
-            m_command_pool = VK_NULL_HANDLE;
+            // a buffer left recording could not be begun again by its next user
+            if (m_is_recording)
+            {
+                vkEndCommandBuffer(m_command_buffer);
+            }
 
-            DEBUG("  Destroyed command pool");
+            CommandAllocator::instance().release(m_command_pool, m_command_buffer, m_level);
+            m_command_buffer = VK_NULL_HANDLE;
+            m_command_pool   = VK_NULL_HANDLE;
         }
 
         m_is_recording = false;
     }
 
-    bool CommandBuffer::createCommandPool()
+    bool CommandBuffer::create(VkCommandBufferLevel level, uint32_t frame_slot, QueueType queue_type)
     {
-        RHI& rhi = RHI::instance();
-
-        VkCommandPoolCreateInfo pool_info = {};
-        pool_info.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        pool_info.flags                   = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-        pool_info.queueFamilyIndex        = rhi.getGraphicsQueueFamilyIndex();
+        cleanup();
 
-        if (vkCreateCommandPool(rhi.getDevice(), &pool_info, nullptr, &m_command_pool) != VK_SUCCESS)
-        {
-            ERROR("Failed to create command pool.");
-            return false;
-        }
-
-        return true;
-    }
-
-    bool CommandBuffer::create(VkCommandBufferLevel level)
-    {
-        RHI& rhi = RHI::instance();
-
-        if (m_command_pool == VK_NULL_HANDLE)
-        {
-            if (!createCommandPool())
-                return false;
-        }
-
-        VkCommandBufferAllocateInfo alloc_info = {};
-        alloc_info.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        alloc_info.commandPool                 = m_command_pool;
-        alloc_info.level                       = level;
-        alloc_info.commandBufferCount          = 1;
-
-        if (vkAllocateCommandBuffers(rhi.getDevice(), &alloc_info, &m_command_buffer) != VK_SUCCESS)
+        m_command_buffer = CommandAllocator::instance().acquire(level, frame_slot, queue_type, m_command_pool);
+        if (m_command_buffer == VK_NULL_HANDLE)
         {
             ERROR("Failed to allocate command buffer.");
             return false;
         }
 
+        m_level      = level;
+        m_queue_type = queue_type;
         return true;
     }
 
@@ -121,11 +89,9 @@ namespace Nano
         return true;
     }
 
-    bool CommandBuffer::submit(VkQueue              queue,
-                               VkSemaphore          wait_semaphore,
-                               VkSemaphore          signal_semaphore,
-                               VkPipelineStageFlags wait_stage,
-                               VkFence              fence)
+    bool CommandBuffer::submit(VkQueue                                queue,
+                               std::initializer_list<SemaphoreSubmit> waits,
+                               std::initializer_list<SemaphoreSubmit> signals)
     {
         if (m_is_recording)
         {
@@ -139,25 +105,58 @@ namespace Nano
             return false;
         }
 
-        VkSubmitInfo submit_info       = {};
-        submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submit_info.commandBufferCount = 1;
-        submit_info.pCommandBuffers    = &m_command_buffer;
+        if (waits.size() > MAX_SUBMIT_SEMAPHORES || signals.size() > MAX_SUBMIT_SEMAPHORES)
+        {
+            ERROR("Too many semaphores in one submission.");
+            return false;
+        }
 
-        if (wait_semaphore != VK_NULL_HANDLE)
+        VkSemaphore          wait_semaphores[MAX_SUBMIT_SEMAPHORES];
+        uint64_t             wait_values[MAX_SUBMIT_SEMAPHORES];
+        VkPipelineStageFlags wait_stages[MAX_SUBMIT_SEMAPHORES];
+        uint32_t             wait_count = 0;
+        for (const SemaphoreSubmit& wait : waits)
         {
-            submit_info.waitSemaphoreCount = 1;
-            submit_info.pWaitSemaphores    = &wait_semaphore;
-            submit_info.pWaitDstStageMask  = &wait_stage;
+            if (wait.semaphore == VK_NULL_HANDLE)
+            {
+                continue;
+            }
+
+            wait_semaphores[wait_count] = wait.semaphore;
+            wait_values[wait_count]     = wait.value;
+            wait_stages[wait_count]     = wait.stage;
+            ++wait_count;
         }
 
-        if (signal_semaphore != VK_NULL_HANDLE)
+        VkSemaphore signal_semaphores[MAX_SUBMIT_SEMAPHORES];
+        uint64_t    signal_values[MAX_SUBMIT_SEMAPHORES];
+        uint32_t    signal_count = 0;
+        for (const SemaphoreSubmit& signal : signals)
         {
-            submit_info.signalSemaphoreCount = 1;
-            submit_info.pSignalSemaphores    = &signal_semaphore;
+            signal_semaphores[signal_count] = signal.semaphore;
+            signal_values[signal_count]     = signal.value;
+            ++signal_count;
         }
 
-        if (vkQueueSubmit(queue, 1, &submit_info, fence) != VK_SUCCESS)
+        VkTimelineSemaphoreSubmitInfo timeline_info = {};
+        timeline_info.sType                         = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timeline_info.waitSemaphoreValueCount       = wait_count;
+        timeline_info.pWaitSemaphoreValues          = wait_values;
+        timeline_info.signalSemaphoreValueCount     = signal_count;
+        timeline_info.pSignalSemaphoreValues        = signal_values;
+
+        VkSubmitInfo submit_info         = {};
+        submit_info.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.pNext                = &timeline_info;
+        submit_info.waitSemaphoreCount   = wait_count;
+        submit_info.pWaitSemaphores      = wait_semaphores;
+        submit_info.pWaitDstStageMask    = wait_stages;
+        submit_info.commandBufferCount   = 1;
+        submit_info.pCommandBuffers      = &m_command_buffer;
+        submit_info.signalSemaphoreCount = signal_count;
+        submit_info.pSignalSemaphores    = signal_semaphores;
+
+        if (vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
         {
             ERROR("Failed to submit command buffer.");
             return false;
@@ -166,6 +165,35 @@ namespace Nano
         return true;
     }
 
+    bool CommandBuffer::submitTimeline(uint64_t& out_signal_value, std::initializer_list<SemaphoreSubmit> waits)
+    {
+        RHI& rhi = RHI::instance();
+
+        VkQueue     queue    = rhi.getQueue(m_queue_type);
+        VkSemaphore timeline = rhi.getTimeline(m_queue_type);
+        out_signal_value     = rhi.reserveTimelineValue(m_queue_type);
+
+        if (submit(queue, waits, {{timeline, out_signal_value}}))
+        {
+            return true;
+        }
+
+        // later values can only be signaled after this one, so an empty batch signals it in place of the buffer
+        VkTimelineSemaphoreSubmitInfo timeline_info = {};
+        timeline_info.sType                         = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timeline_info.signalSemaphoreValueCount     = 1;
+        timeline_info.pSignalSemaphoreValues        = &out_signal_value;
+
+        VkSubmitInfo submit_info         = {};
+        submit_info.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.pNext                = &timeline_info;
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores    = &timeline;
+        vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE);
+
+        return false;
+    }
+
     bool CommandBuffer::reset(VkCommandBufferResetFlags flags)
     {
         if (m_command_buffer == VK_NULL_HANDLE)
@@ -189,4 +217,34 @@ namespace Nano
         return true;
     }
 
+    void CommandBuffer::memoryBarrier(VkPipelineStageFlags src_stage,
+                                      VkAccessFlags        src_access,
+                                      VkPipelineStageFlags dst_stage,
+                                      VkAccessFlags        dst_access)
+    {
+        if (!m_is_recording)
+        {
+            ERROR("Cannot record barrier while command buffer is not recording.");
+            return;
+        }
+
+        VkMemoryBarrier barrier = {};
+        barrier.sType           = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask   = src_access;
+        barrier.dstAccessMask   = dst_access;
+
+        vkCmdPipelineBarrier(m_command_buffer, src_stage, dst_stage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    void CommandBuffer::updateBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const void* data)
+    {
+        if (!m_is_recording)
+        {
+            ERROR("Cannot record buffer update while command buffer is not recording.");
+            return;
+        }
+
+        vkCmdUpdateBuffer(m_command_buffer, buffer, offset, size, data);
+    }
+
 } // namespace Nano
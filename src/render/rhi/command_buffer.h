@@ -2,9 +2,22 @@
 #define COMMAND_BUFFER_H
 
 #include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <initializer_list>
+#include "command_allocator.h"
 
 namespace Nano
 {
+    // One semaphore wait or signal of a submission. value is the timeline value and is ignored for binary
+    // semaphores, stage only applies to waits. Waits on VK_NULL_HANDLE are skipped, so optional ones can stay in
+    // fixed lists.
+    struct SemaphoreSubmit
+    {
+        VkSemaphore          semaphore {VK_NULL_HANDLE};
+        uint64_t             value {0};
+        VkPipelineStageFlags stage {VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+    };
+
     class CommandBuffer
     {
     public:
@@ -16,28 +29,46 @@ namespace Nano
         CommandBuffer(CommandBuffer&&) noexcept            = delete;
         CommandBuffer& operator=(CommandBuffer&&) noexcept = delete;
 
-        bool create(VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+        // Takes a buffer from the CommandAllocator pool of the calling thread for the frame slot and queue, it goes
+        // back to the allocator on destruction.
+        bool create(VkCommandBufferLevel level      = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                    uint32_t             frame_slot = CommandAllocator::CURRENT_FRAME_SLOT,
+                    QueueType            queue_type = QueueType::Graphics);
 
         bool begin(VkCommandBufferUsageFlags flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
         bool end();
 
-        bool submit(VkQueue              queue,
-                    VkSemaphore          wait_semaphore   = VK_NULL_HANDLE,
-                    VkSemaphore          signal_semaphore = VK_NULL_HANDLE,
-                    VkPipelineStageFlags wait_stage       = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                    VkFence              fence            = VK_NULL_HANDLE);
+        static constexpr uint32_t MAX_SUBMIT_SEMAPHORES {4}; // per list
+
+        // Binary and timeline semaphores can be mixed in both lists.
+        bool submit(VkQueue                                queue,
+                    std::initializer_list<SemaphoreSubmit> waits   = {},
+                    std::initializer_list<SemaphoreSubmit> signals = {});
+        // Submits to the queue the buffer was created for and signals that queue's RHI timeline with the returned
+        // value, which is signaled even when the submission fails so that waiting on it cannot hang.
+        bool submitTimeline(uint64_t& out_signal_value, std::initializer_list<SemaphoreSubmit> waits = {});
         bool reset(VkCommandBufferResetFlags flags = 0);
 
+        // Global memory barrier, enough for the buffer-only dependencies between chained dispatches.
+        void memoryBarrier(VkPipelineStageFlags src_stage,
+                           VkAccessFlags        src_access,
+                           VkPipelineStageFlags dst_stage,
+                           VkAccessFlags        dst_access);
+        // Inline buffer write ordered with the rest of the command stream, size must be a multiple of 4 and <= 64KB.
+        void updateBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const void* data);
+
         VkCommandBuffer getCommandBuffer() const { return m_command_buffer; }
+        QueueType       getQueueType() const { return m_queue_type; }
         bool            isRecording() const { return m_is_recording; }
 
     private:
-        bool createCommandPool();
         void cleanup();
 
-        VkCommandBuffer m_command_buffer {VK_NULL_HANDLE};
-        VkCommandPool   m_command_pool {VK_NULL_HANDLE};
-        bool            m_is_recording {false};
+        VkCommandBuffer      m_command_buffer {VK_NULL_HANDLE};
+        VkCommandPool        m_command_pool {VK_NULL_HANDLE}; // owned by the CommandAllocator
+        VkCommandBufferLevel m_level {VK_COMMAND_BUFFER_LEVEL_PRIMARY};
+        QueueType            m_queue_type {QueueType::Graphics};
+        bool                 m_is_recording {false};
     };
 
 } // namespace Nano
@@ -0,0 +1,190 @@
+#include "descriptor_allocator.h"
+#include <algorithm>
+#include "misc/logger.h"
+#include "rhi.h"
+
+namespace Nano
+{
+    // pools are destroyed through the device, so make sure the RHI singleton outlives this one
+    DescriptorAllocator::DescriptorAllocator() { RHI::instance(); }
+
+    DescriptorAllocator::~DescriptorAllocator() noexcept
+    {
+        RHI& rhi = RHI::instance();
+        if (rhi.getDevice() == VK_NULL_HANDLE)
+            return;
+
+        vkDeviceWaitIdle(rhi.getDevice());
+
+        // destroying a pool frees every set allocated from it
+        for (VkDescriptorPool pool : m_persistent_pools)
+        {
+            vkDestroyDescriptorPool(rhi.getDevice(), pool, nullptr);
+        }
+        m_persistent_pools.clear();
+
+        for (FramePools& frame_pools : m_frame_pools)
+        {
+            for (VkDescriptorPool pool : frame_pools.pools)
+            {
+                vkDestroyDescriptorPool(rhi.getDevice(), pool, nullptr);
+            }
+            frame_pools.pools.clear();
+        }
+
+        DEBUG("  Destroyed descriptor pools");
+    }
+
+    VkDescriptorPool DescriptorAllocator::createPoolLocked(const std::vector<VkDescriptorPoolSize>& pool_sizes,
+                                                           bool                                     is_freeable)
+    {
+        RHI& rhi = RHI::instance();
+
+        // the average set so far, rounded up
+        std::vector<VkDescriptorPoolSize> sizes;
+        for (const auto& descriptor_count : m_descriptor_counts)
+        {
+            uint64_t count = (descriptor_count.second * SETS_PER_POOL + m_set_count - 1) / m_set_count;
+            sizes.push_back({descriptor_count.first, static_cast<uint32_t>(count)});
+        }
+
+        // a set far above the average still has to fit
+        for (const VkDescriptorPoolSize& pool_size : pool_sizes)
+        {
+            for (VkDescriptorPoolSize& size : sizes)
+            {
+                if (size.type == pool_size.type)
+                {
+                    size.descriptorCount = std::max(size.descriptorCount, pool_size.descriptorCount);
+                }
+            }
+        }
+
+        VkDescriptorPoolCreateInfo pool_info = {};
+        pool_info.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.flags                      = is_freeable ? VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT : 0;
+        pool_info.maxSets                    = SETS_PER_POOL;
+        pool_info.poolSizeCount              = static_cast<uint32_t>(sizes.size());
+        pool_info.pPoolSizes                 = sizes.data();
+
+        VkDescriptorPool pool = VK_NULL_HANDLE;
+        if (vkCreateDescriptorPool(rhi.getDevice(), &pool_info, nullptr, &pool) != VK_SUCCESS)
+        {
+            ERROR("Failed to create descriptor pool.");
+            return VK_NULL_HANDLE;
+        }
+
+        DEBUG("Created %s descriptor pool for %u sets, %zu descriptor types",
+              is_freeable ? "persistent" : "frame",
+              SETS_PER_POOL,
+              sizes.size());
+        return pool;
+    }
+
+    bool DescriptorAllocator::allocateFromPool(VkDescriptorPool      pool,
+                                               VkDescriptorSetLayout layout,
+                                               VkDescriptorSet&      out_set)
+    {
+        VkDescriptorSetAllocateInfo alloc_info = {};
+        alloc_info.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorPool              = pool;
+        alloc_info.descriptorSetCount          = 1;
+        alloc_info.pSetLayouts                 = &layout;
+
+        // out of pool memory and fragmentation only mean the next pool has to take it
+        return vkAllocateDescriptorSets(RHI::instance().getDevice(), &alloc_info, &out_set) == VK_SUCCESS;
+    }
+
+    bool DescriptorAllocator::allocate(VkDescriptorSetLayout                    layout,
+                                       const std::vector<VkDescriptorPoolSize>& pool_sizes,
+                                       DescriptorLifetime                       lifetime,
+                                       DescriptorAllocation&                    out_allocation)
+    {
+        if (layout == VK_NULL_HANDLE)
+        {
+            ERROR("Cannot allocate descriptor set with null layout.");
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (const VkDescriptorPoolSize& pool_size : pool_sizes)
+        {
+            m_descriptor_counts[pool_size.type] += pool_size.descriptorCount;
+        }
+        ++m_set_count;
+
+        bool        is_freeable = lifetime == DescriptorLifetime::Persistent;
+        FramePools& frame_pools = m_frame_pools[m_frame_slot];
+        auto&       pools       = is_freeable ? m_persistent_pools : frame_pools.pools;
+        // persistent sets may have been freed from any pool, frame pools stay full until their reset
+        size_t first_pool = is_freeable ? 0 : frame_pools.current;
+
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        for (size_t pool_index = pools.size(); pool_index > first_pool; --pool_index)
+        {
+            if (allocateFromPool(pools[pool_index - 1], layout, set))
+            {
+                out_allocation = {set, pools[pool_index - 1], lifetime};
+                return true;
+            }
+        }
+
+        VkDescriptorPool pool = createPoolLocked(pool_sizes, is_freeable);
+        if (pool == VK_NULL_HANDLE)
+        {
+            return false;
+        }
+        pools.push_back(pool);
+        if (!is_freeable)
+        {
+            frame_pools.current = static_cast<uint32_t>(pools.size() - 1);
+        }
+
+        if (!allocateFromPool(pool, layout, set))
+        {
+            ERROR("Failed to allocate descriptor set.");
+            return false;
+        }
+
+        out_allocation = {set, pool, lifetime};
+        return true;
+    }
+
+    void DescriptorAllocator::free(DescriptorAllocation& allocation)
+    {
+        if (allocation.set == VK_NULL_HANDLE)
+            return;
+
+        if (allocation.lifetime == DescriptorLifetime::Persistent)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            vkFreeDescriptorSets(RHI::instance().getDevice(), allocation.pool, 1, &allocation.set);
+        }
+
+        allocation = {};
+    }
+
+    void DescriptorAllocator::beginFrame(uint32_t frame_slot)
+    {
+        RHI& rhi = RHI::instance();
+
+        if (frame_slot >= FRAME_SLOT_COUNT)
+        {
+            ERROR("Invalid frame slot %u.", frame_slot);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        FramePools& frame_pools = m_frame_pools[frame_slot];
+        for (VkDescriptorPool pool : frame_pools.pools)
+        {
+            vkResetDescriptorPool(rhi.getDevice(), pool, 0);
+        }
+        frame_pools.current = 0;
+
+        m_frame_slot = frame_slot;
+    }
+
+} // namespace Nano
@@ -0,0 +1,85 @@
+#ifndef DESCRIPTOR_ALLOCATOR_H
+#define DESCRIPTOR_ALLOCATOR_H
+
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "command_allocator.h"
+
+namespace Nano
+{
+    enum class DescriptorLifetime : uint8_t
+    {
+        Persistent, // lives until freed, e.g. the set of a RenderPass or Material
+        Frame,      // only valid for the frame it was allocated in
+    };
+
+    // A set handed out by the DescriptorAllocator, free() needs to know where it came from.
+    struct DescriptorAllocation
+    {
+        VkDescriptorSet    set {VK_NULL_HANDLE};
+        VkDescriptorPool   pool {VK_NULL_HANDLE};
+        DescriptorLifetime lifetime {DescriptorLifetime::Persistent};
+    };
+
+    // Allocates descriptor sets from shared pools instead of one pool per set. Persistent sets come from pools that
+    // can free single sets, frame sets from pools per frame slot that beginFrame() resets as a whole. Pools are added
+    // when the existing ones run out, sized from the average number of descriptors per set of each type allocated
+    // so far.
+    class DescriptorAllocator final
+    {
+    public:
+        static DescriptorAllocator& instance()
+        {
+            static DescriptorAllocator s_descriptor_allocator;
+            return s_descriptor_allocator;
+        }
+
+        static constexpr uint32_t SETS_PER_POOL {64};
+        static constexpr uint32_t FRAME_SLOT_COUNT {CommandAllocator::FRAME_SLOT_COUNT};
+
+        // pool_sizes are the descriptors of one set with the layout.
+        bool allocate(VkDescriptorSetLayout                    layout,
+                      const std::vector<VkDescriptorPoolSize>& pool_sizes,
+                      DescriptorLifetime                       lifetime,
+                      DescriptorAllocation&                    out_allocation);
+        // Frame sets go away with their frame, freeing one only forgets it.
+        void free(DescriptorAllocation& allocation);
+
+        // Resets the frame pools of the slot, the GPU must be done with the slot's sets. Frame sets allocated
+        // afterwards come from this slot.
+        void beginFrame(uint32_t frame_slot);
+
+    protected:
+        DescriptorAllocator();
+        ~DescriptorAllocator() noexcept;
+
+        DescriptorAllocator(const DescriptorAllocator&)            = delete;
+        DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+        DescriptorAllocator(DescriptorAllocator&&)                 = delete;
+        DescriptorAllocator& operator=(DescriptorAllocator&&)      = delete;
+
+    private:
+        struct FramePools
+        {
+            std::vector<VkDescriptorPool> pools;
+            uint32_t                      current {0}; // pools before it ran full this frame
+        };
+
+        // Sized for SETS_PER_POOL average sets, and at least for one set with pool_sizes.
+        VkDescriptorPool createPoolLocked(const std::vector<VkDescriptorPoolSize>& pool_sizes, bool is_freeable);
+        bool allocateFromPool(VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet& out_set);
+
+        std::mutex                           m_mutex;
+        std::vector<VkDescriptorPool>        m_persistent_pools;
+        FramePools                           m_frame_pools[FRAME_SLOT_COUNT];
+        uint32_t                             m_frame_slot {0};
+        std::map<VkDescriptorType, uint64_t> m_descriptor_counts; // of every set allocated so far
+        uint64_t                             m_set_count {0};
+    };
+
+} // namespace Nano
+
+#endif // !DESCRIPTOR_ALLOCATOR_H
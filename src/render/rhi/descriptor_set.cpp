@@ -52,29 +52,19 @@ namespace Nano
 
     void DescriptorSet::cleanup()
     {
-        RHI& rhi = RHI::instance();
-
-        if (m_descriptor_set != VK_NULL_HANDLE && m_descriptor_pool != VK_NULL_HANDLE)
+        if (m_allocation.set != VK_NULL_HANDLE)
         {
-            vkFreeDescriptorSets(rhi.getDevice(), m_descriptor_pool, 1, &m_descriptor_set);
-            m_descriptor_set = VK_NULL_HANDLE;
+            DescriptorAllocator::instance().free(m_allocation);
             DEBUG("  Freed descriptor set");
         }
 
-        if (m_descriptor_pool != VK_NULL_HANDLE)
-        {
-            vkDestroyDescriptorPool(rhi.getDevice(), m_descriptor_pool, nullptr);
-            m_descriptor_pool = VK_NULL_HANDLE;
-            DEBUG("  Destroyed descriptor pool");
-        }
-
         m_layout = VK_NULL_HANDLE;
     }
 
-    bool DescriptorSet::allocate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorPoolSize>& pool_sizes)
+    bool DescriptorSet::allocate(VkDescriptorSetLayout                    layout,
+                                 const std::vector<VkDescriptorPoolSize>& pool_sizes,
+                                 DescriptorLifetime                       lifetime)
     {
-        RHI& rhi = RHI::instance();
-
         if (layout == VK_NULL_HANDLE)
         {
             ERROR("Cannot allocate descriptor set with null layout.");
@@ -87,30 +77,11 @@ namespace Nano
             return false;
         }
 
+        // a set allocated again gives its old one back first
+        cleanup();
         m_layout = layout;
 
-        // Create descriptor pool
-        VkDescriptorPoolCreateInfo pool_info = {};
-        pool_info.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        pool_info.poolSizeCount              = static_cast<uint32_t>(pool_sizes.size());
-        pool_info.pPoolSizes                 = pool_sizes.data();
-        pool_info.maxSets                    = 1;
-        pool_info.flags                      = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-
-        if (vkCreateDescriptorPool(rhi.getDevice(), &pool_info, nullptr, &m_descriptor_pool) != VK_SUCCESS)
-        {
-            ERROR("Failed to create descriptor pool.");
-            return false;
-        }
-
-        // Allocate descriptor set
-        VkDescriptorSetAllocateInfo alloc_info = {};
-        alloc_info.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        alloc_info.descriptorPool              = m_descriptor_pool;
-        alloc_info.descriptorSetCount          = 1;
-        alloc_info.pSetLayouts                 = &layout;
-
-        if (vkAllocateDescriptorSets(rhi.getDevice(), &alloc_info, &m_descriptor_set) != VK_SUCCESS)
+        if (!DescriptorAllocator::instance().allocate(layout, pool_sizes, lifetime, m_allocation))
         {
             ERROR("Failed to allocate descriptor set.");
             return false;
@@ -119,9 +90,9 @@ namespace Nano
         return true;
     }
 
-    bool DescriptorSet::updateBuffer(uint32_t binding, Buffer* buffer, VkDescriptorType type)
+    bool DescriptorSet::updateBuffer(uint32_t binding, Buffer* buffer, VkDescriptorType type, VkDeviceSize range)
     {
-        if (m_descriptor_set == VK_NULL_HANDLE)
+        if (m_allocation.set == VK_NULL_HANDLE)
         {
             ERROR("Descriptor set not allocated. Call allocate() first.");
             return false;
@@ -136,11 +107,11 @@ namespace Nano
         VkDescriptorBufferInfo buffer_info = {};
         buffer_info.buffer                 = buffer->getBuffer();
         buffer_info.offset                 = 0;
-        buffer_info.range                  = buffer->getSize();
+        buffer_info.range                  = range == VK_WHOLE_SIZE ? buffer->getSize() : range;
 
         VkWriteDescriptorSet descriptor_write = {};
         descriptor_write.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptor_write.dstSet               = m_descriptor_set;
+        descriptor_write.dstSet               = m_allocation.set;
         descriptor_write.dstBinding           = binding;
         descriptor_write.dstArrayElement      = 0;
         descriptor_write.descriptorType       = type;
@@ -154,7 +125,7 @@ namespace Nano
 
     bool DescriptorSet::updateTexture(uint32_t binding, Texture* texture, VkSampler sampler, VkDescriptorType type)
     {
-        if (m_descriptor_set == VK_NULL_HANDLE)
+        if (m_allocation.set == VK_NULL_HANDLE)
         {
             ERROR("Descriptor set not allocated. Call allocate() first.");
             return false;
@@ -173,7 +144,7 @@ namespace Nano
 
         VkWriteDescriptorSet descriptor_write = {};
         descriptor_write.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptor_write.dstSet               = m_descriptor_set;
+        descriptor_write.dstSet               = m_allocation.set;
         descriptor_write.dstBinding           = binding;
         descriptor_write.dstArrayElement      = 0;
         descriptor_write.descriptorType       = type;
@@ -190,7 +161,7 @@ namespace Nano
                                     VkImageLayout    image_layout,
                                     VkDescriptorType type)
     {
-        if (m_descriptor_set == VK_NULL_HANDLE)
+        if (m_allocation.set == VK_NULL_HANDLE)
         {
             ERROR("Descriptor set not allocated. Call allocate() first.");
             return false;
@@ -209,7 +180,7 @@ namespace Nano
 
         VkWriteDescriptorSet descriptor_write = {};
         descriptor_write.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptor_write.dstSet               = m_descriptor_set;
+        descriptor_write.dstSet               = m_allocation.set;
         descriptor_write.dstBinding           = binding;
         descriptor_write.dstArrayElement      = 0;
         descriptor_write.descriptorType       = type;
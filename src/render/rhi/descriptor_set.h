@@ -4,6 +4,7 @@
 #include <vulkan/vulkan_core.h>
 #include <vector>
 #include "render/rhi/buffer.h"
+#include "render/rhi/descriptor_allocator.h"
 #include "render/rhi/texture.h"
 
 namespace Nano
@@ -40,21 +41,27 @@ namespace Nano
         DescriptorSet(DescriptorSet&&) noexcept            = delete;
         DescriptorSet& operator=(DescriptorSet&&) noexcept = delete;
 
-        bool allocate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorPoolSize>& pool_sizes);
-        bool updateBuffer(uint32_t binding, Buffer* buffer, VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+        // pool_sizes are the descriptors the layout needs, the set itself comes from the shared DescriptorAllocator.
+        bool allocate(VkDescriptorSetLayout                    layout,
+                      const std::vector<VkDescriptorPoolSize>& pool_sizes,
+                      DescriptorLifetime                       lifetime = DescriptorLifetime::Persistent);
+        // Dynamic buffer descriptors only cover range bytes, the dynamic offset moves that window at bind time.
+        bool updateBuffer(uint32_t         binding,
+                          Buffer*          buffer,
+                          VkDescriptorType type  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                          VkDeviceSize     range = VK_WHOLE_SIZE);
         bool updateTexture(uint32_t         binding,
                            Texture*         texture,
                            VkSampler        sampler,
                            VkDescriptorType type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
         bool updateImage(uint32_t binding, VkImageView image_view, VkImageLayout image_layout, VkDescriptorType type);
 
-        VkDescriptorSet getDescriptorSet() const { return m_descriptor_set; }
+        VkDescriptorSet getDescriptorSet() const { return m_allocation.set; }
 
     private:
         void cleanup();
 
-        VkDescriptorSet       m_descriptor_set {VK_NULL_HANDLE};
-        VkDescriptorPool      m_descriptor_pool {VK_NULL_HANDLE};
+        DescriptorAllocation  m_allocation;
         VkDescriptorSetLayout m_layout {VK_NULL_HANDLE};
     };
 
@@ -0,0 +1,85 @@
+#include "dynamic_buffer.h"
+#include <algorithm>
+#include <cstring>
+#include "misc/logger.h"
+#include "rhi.h"
+
+namespace Nano
+{
+    DynamicBuffer::DynamicBuffer() {}
+
+    DynamicBuffer::~DynamicBuffer() noexcept {}
+
+    bool DynamicBuffer::create(VkBufferUsageFlags usage, VkDeviceSize frame_size)
+    {
+        RHI& rhi = RHI::instance();
+
+        // dynamic offsets have to respect the alignment of every descriptor type the buffer may be bound as
+        VkPhysicalDeviceProperties device_props {};
+        vkGetPhysicalDeviceProperties(rhi.getPhysicalDevice(), &device_props);
+        m_alignment = 1;
+        if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+        {
+            m_alignment = std::max(m_alignment, device_props.limits.minUniformBufferOffsetAlignment);
+        }
+        if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+        {
+            m_alignment = std::max(m_alignment, device_props.limits.minStorageBufferOffsetAlignment);
+        }
+
+        m_frame_size = (frame_size + m_alignment - 1) / m_alignment * m_alignment;
+        if (!m_buffer.create(usage,
+                             m_frame_size * FRAME_REGION_COUNT,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+        {
+            ERROR("Failed to create dynamic buffer.");
+            return false;
+        }
+
+        // stays mapped until the buffer goes away
+        m_mapped = static_cast<uint8_t*>(m_buffer.map());
+        if (m_mapped == nullptr)
+        {
+            ERROR("Failed to map dynamic buffer.");
+            return false;
+        }
+
+        m_region_begin = 0;
+        m_cursor       = 0;
+        return true;
+    }
+
+    void DynamicBuffer::beginFrame(uint32_t frame_slot)
+    {
+        if (frame_slot >= FRAME_REGION_COUNT)
+        {
+            ERROR("Invalid frame slot %u.", frame_slot);
+            return;
+        }
+
+        m_region_begin = m_frame_size * frame_slot;
+        m_cursor       = 0;
+    }
+
+    bool DynamicBuffer::write(const void* data, VkDeviceSize size, uint32_t& out_offset)
+    {
+        if (m_mapped == nullptr)
+        {
+            ERROR("Dynamic buffer not created. Call create() first.");
+            return false;
+        }
+
+        VkDeviceSize offset = (m_cursor + m_alignment - 1) / m_alignment * m_alignment;
+        if (offset + size > m_frame_size)
+        {
+            ERROR("Dynamic buffer frame region of %llu bytes is full.", static_cast<unsigned long long>(m_frame_size));
+            return false;
+        }
+
+        std::memcpy(m_mapped + m_region_begin + offset, data, size);
+        m_cursor   = offset + size;
+        out_offset = static_cast<uint32_t>(m_region_begin + offset);
+        return true;
+    }
+
+} // namespace Nano
@@ -0,0 +1,55 @@
+#ifndef DYNAMIC_BUFFER_H
+#define DYNAMIC_BUFFER_H
+
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include "buffer.h"
+#include "command_allocator.h"
+
+namespace Nano
+{
+    // Persistently mapped buffer with one region per frame slot, for constants written every frame. Writes are
+    // sub-allocated linearly from the current frame's region and bound with dynamic offsets, so the frame loop
+    // neither maps memory nor records copies. A region is only rewound when its frame slot comes around again, after
+    // FrameContext::begin() waited for the GPU to finish with it.
+    class DynamicBuffer
+    {
+    public:
+        static constexpr uint32_t FRAME_REGION_COUNT {CommandAllocator::FRAME_SLOT_COUNT};
+
+        DynamicBuffer();
+        ~DynamicBuffer() noexcept;
+
+        DynamicBuffer(const DynamicBuffer&)                = delete;
+        DynamicBuffer& operator=(const DynamicBuffer&)     = delete;
+        DynamicBuffer(DynamicBuffer&&) noexcept            = delete;
+        DynamicBuffer& operator=(DynamicBuffer&&) noexcept = delete;
+
+        // frame_size is what one frame can write, the buffer holds FRAME_REGION_COUNT of them.
+        bool create(VkBufferUsageFlags usage, VkDeviceSize frame_size);
+
+        // Rewinds the region of the frame slot, the GPU must be done reading it.
+        void beginFrame(uint32_t frame_slot);
+        // Copies data into the current region, out_offset is the dynamic offset to bind it at.
+        bool write(const void* data, VkDeviceSize size, uint32_t& out_offset);
+        template<typename T>
+        bool write(const T& data, uint32_t& out_offset)
+        {
+            return write(&data, sizeof(T), out_offset);
+        }
+
+        Buffer*      getBuffer() { return &m_buffer; }
+        VkDeviceSize getFrameSize() const { return m_frame_size; }
+
+    private:
+        Buffer       m_buffer;
+        uint8_t*     m_mapped {nullptr};
+        VkDeviceSize m_frame_size {0};
+        VkDeviceSize m_alignment {1};
+        VkDeviceSize m_region_begin {0};
+        VkDeviceSize m_cursor {0}; // within the current region
+    };
+
+} // namespace Nano
+
+#endif // !DYNAMIC_BUFFER_H
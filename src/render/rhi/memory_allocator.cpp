@@ -0,0 +1,383 @@
+#include "memory_allocator.h"
+#include <algorithm>
+#include "misc/logger.h"
+#include "rhi.h"
+
+namespace Nano
+{
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // whether the last byte of one resource and the first byte of the next share a granularity page
+    static bool isOnSamePage(VkDeviceSize end, VkDeviceSize begin, VkDeviceSize granularity)
+    {
+        return (end - 1) / granularity == begin / granularity;
+    }
+
+    // blocks are freed through the device, so make sure the RHI singleton outlives this one
+    MemoryAllocator::MemoryAllocator()
+    {
+        RHI& rhi = RHI::instance();
+
+        VkPhysicalDeviceProperties device_props {};
+        vkGetPhysicalDeviceProperties(rhi.getPhysicalDevice(), &device_props);
+        m_buffer_image_granularity = std::max<VkDeviceSize>(device_props.limits.bufferImageGranularity, 1);
+    }
+
+    MemoryAllocator::~MemoryAllocator() noexcept
+    {
+        RHI& rhi = RHI::instance();
+        if (rhi.getDevice() == VK_NULL_HANDLE)
+            return;
+
+        for (auto& block : m_blocks)
+        {
+            if (block == nullptr)
+                continue;
+
+            bool is_empty = block->ranges.size() == 1 && block->ranges[0].is_free;
+            if (!is_empty)
+            {
+                WARN("Memory block of type %u still has allocations.", block->memory_type_index);
+            }
+
+            // freeing implicitly unmaps
+            vkFreeMemory(rhi.getDevice(), block->memory, nullptr);
+            DEBUG("  Released memory block");
+        }
+        m_blocks.clear();
+
+        if (m_dedicated_count != 0)
+        {
+            WARN("%u dedicated allocations were not freed.", m_dedicated_count);
+        }
+    }
+
+    VkDeviceSize MemoryAllocator::getBlockSize(uint32_t memory_type_index) const
+    {
+        const VkPhysicalDeviceMemoryProperties& memory_props = RHI::instance().getMemoryProperties();
+
+        // small heaps, e.g. the 256 MB host visible device local one without resizable BAR, get smaller blocks
+        VkDeviceSize heap_size = memory_props.memoryHeaps[memory_props.memoryTypes[memory_type_index].heapIndex].size;
+        return std::min(DEFAULT_BLOCK_SIZE, heap_size / 8);
+    }
+
+    bool MemoryAllocator::allocateDeviceMemory(VkDeviceSize    size,
+                                               uint32_t        memory_type_index,
+                                               const void*     next,
+                                               VkDeviceMemory& out_memory,
+                                               void*&          out_mapped)
+    {
+        RHI& rhi = RHI::instance();
+
+        VkMemoryAllocateInfo vkMemoryAllocInfo = {};
+        vkMemoryAllocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        vkMemoryAllocInfo.pNext                = next;
+        vkMemoryAllocInfo.allocationSize       = size;
+        vkMemoryAllocInfo.memoryTypeIndex      = memory_type_index;
+
+        if (vkAllocateMemory(rhi.getDevice(), &vkMemoryAllocInfo, nullptr, &out_memory) != VK_SUCCESS)
+        {
+            ERROR("Failed to allocate %llu bytes of memory type %u.",
+                  static_cast<unsigned long long>(size),
+                  memory_type_index);
+            return false;
+        }
+
+        // a VkDeviceMemory can only be mapped once, so host visible memory is mapped as a whole up front
+        out_mapped = nullptr;
+        const VkMemoryPropertyFlags type_flags =
+            rhi.getMemoryProperties().memoryTypes[memory_type_index].propertyFlags;
+        if ((type_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0 &&
+            vkMapMemory(rhi.getDevice(), out_memory, 0, VK_WHOLE_SIZE, 0, &out_mapped) != VK_SUCCESS)
+        {
+            ERROR("Failed to map memory of type %u.", memory_type_index);
+            vkFreeMemory(rhi.getDevice(), out_memory, nullptr);
+            out_memory = VK_NULL_HANDLE;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool MemoryAllocator::allocateDedicatedLocked(const VkMemoryRequirements& requirements,
+                                                  uint32_t                    memory_type_index,
+                                                  const void*                 next,
+                                                  MemoryAllocation&           out_allocation)
+    {
+        MemoryAllocation allocation;
+        if (!allocateDeviceMemory(requirements.size, memory_type_index, next, allocation.memory, allocation.mapped))
+        {
+            return false;
+        }
+
+        allocation.size              = requirements.size;
+        allocation.memory_type_index = memory_type_index;
+        out_allocation               = allocation;
+
+        ++m_dedicated_count;
+        m_dedicated_bytes += requirements.size;
+        return true;
+    }
+
+    bool MemoryAllocator::allocateDedicated(const VkMemoryRequirements& requirements,
+                                            VkMemoryPropertyFlags       property_flags,
+                                            MemoryAllocation&           out_allocation,
+                                            VkImage                     image,
+                                            VkBuffer                    buffer)
+    {
+        RHI& rhi = RHI::instance();
+
+        uint32_t memory_type_index = 0;
+        if (!rhi.findMemoryType(requirements.memoryTypeBits, property_flags, memory_type_index))
+        {
+            ERROR("Failed to find suitable memory type.");
+            return false;
+        }
+
+        VkMemoryDedicatedAllocateInfo dedicated_info = {};
+        dedicated_info.sType                         = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+        dedicated_info.image                         = image;
+        dedicated_info.buffer                        = buffer;
+        bool is_bound_to_resource                    = image != VK_NULL_HANDLE || buffer != VK_NULL_HANDLE;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return allocateDedicatedLocked(
+            requirements, memory_type_index, is_bound_to_resource ? &dedicated_info : nullptr, out_allocation);
+    }
+
+    bool MemoryAllocator::allocate(const VkMemoryRequirements& requirements,
+                                   VkMemoryPropertyFlags       property_flags,
+                                   MemoryResourceKind          kind,
+                                   MemoryAllocation&           out_allocation)
+    {
+        RHI& rhi = RHI::instance();
+
+        uint32_t memory_type_index = 0;
+        if (!rhi.findMemoryType(requirements.memoryTypeBits, property_flags, memory_type_index))
+        {
+            ERROR("Failed to find suitable memory type.");
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // anything taking a good part of a block would mostly leave it empty
+        VkDeviceSize block_size = getBlockSize(memory_type_index);
+        if (requirements.size > block_size / 2)
+        {
+            return allocateDedicatedLocked(requirements, memory_type_index, nullptr, out_allocation);
+        }
+
+        for (uint32_t block_index = 0; block_index < m_blocks.size(); ++block_index)
+        {
+            const Block* block = m_blocks[block_index].get();
+            if (block != nullptr && block->memory_type_index == memory_type_index &&
+                allocateFromBlock(block_index, requirements, kind, out_allocation))
+            {
+                return true;
+            }
+        }
+
+        auto block               = std::make_unique<Block>();
+        block->size              = block_size;
+        block->memory_type_index = memory_type_index;
+        if (!allocateDeviceMemory(block_size, memory_type_index, nullptr, block->memory, block->mapped))
+        {
+            return false;
+        }
+        block->ranges.push_back({0, block_size, true, MemoryResourceKind::Linear});
+
+        // reuse the slot of a released block
+        auto     it          = std::find(m_blocks.begin(), m_blocks.end(), nullptr);
+        uint32_t block_index = static_cast<uint32_t>(it - m_blocks.begin());
+        if (it == m_blocks.end())
+        {
+            m_blocks.push_back(std::move(block));
+        }
+        else
+        {
+            *it = std::move(block);
+        }
+
+        DEBUG("Allocated memory block %u of type %u, %.2f MB",
+              block_index,
+              memory_type_index,
+              block_size / (1024.0 * 1024.0));
+        return allocateFromBlock(block_index, requirements, kind, out_allocation);
+    }
+
+    bool MemoryAllocator::allocateFromBlock(uint32_t                    block_index,
+                                            const VkMemoryRequirements& requirements,
+                                            MemoryResourceKind          kind,
+                                            MemoryAllocation&           out_allocation)
+    {
+        Block&                    block       = *m_blocks[block_index];
+        const std::vector<Range>& ranges      = block.ranges;
+        const VkDeviceSize        granularity = m_buffer_image_granularity;
+
+        // first fit, ranges are few and allocations mostly long lived
+        for (size_t range_index = 0; range_index < ranges.size(); ++range_index)
+        {
+            const Range& range = ranges[range_index];
+            if (!range.is_free || range.size < requirements.size)
+                continue;
+
+            VkDeviceSize offset = alignUp(range.offset, requirements.alignment);
+            if (range_index > 0)
+            {
+                const Range& prev = ranges[range_index - 1];
+                if (!prev.is_free && prev.kind != kind && isOnSamePage(prev.offset + prev.size, offset, granularity))
+                {
+                    offset = alignUp(offset, granularity);
+                }
+            }
+
+            VkDeviceSize end = offset + requirements.size;
+            if (end > range.offset + range.size)
+                continue;
+
+            if (range_index + 1 < ranges.size())
+            {
+                const Range& next = ranges[range_index + 1];
+                if (!next.is_free && next.kind != kind && isOnSamePage(end, next.offset, granularity))
+                    continue;
+            }
+
+            // [padding][allocation][rest], empty parts are dropped. range dies with the erase below.
+            Range padding {range.offset, offset - range.offset, true, kind};
+            Range rest {end, range.offset + range.size - end, true, kind};
+            Range allocation {offset, requirements.size, false, kind};
+
+            std::vector<Range> split;
+            if (padding.size > 0)
+                split.push_back(padding);
+            split.push_back(allocation);
+            if (rest.size > 0)
+                split.push_back(rest);
+
+            block.ranges.erase(block.ranges.begin() + range_index);
+            block.ranges.insert(block.ranges.begin() + range_index, split.begin(), split.end());
+
+            out_allocation.memory            = block.memory;
+            out_allocation.offset            = offset;
+            out_allocation.size              = requirements.size;
+            out_allocation.mapped            = block.mapped != nullptr ? static_cast<uint8_t*>(block.mapped) + offset :
+                                                                         nullptr;
+            out_allocation.memory_type_index = block.memory_type_index;
+            out_allocation.block_index       = block_index;
+            return true;
+        }
+
+        return false;
+    }
+
+    void MemoryAllocator::free(MemoryAllocation& allocation)
+    {
+        if (allocation.memory == VK_NULL_HANDLE)
+            return;
+
+        RHI&                        rhi = RHI::instance();
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (allocation.block_index == MemoryAllocation::DEDICATED_BLOCK_INDEX)
+        {
+            vkFreeMemory(rhi.getDevice(), allocation.memory, nullptr);
+            --m_dedicated_count;
+            m_dedicated_bytes -= allocation.size;
+            allocation = {};
+            return;
+        }
+
+        Block& block = *m_blocks[allocation.block_index];
+        auto   it    = std::find_if(block.ranges.begin(), block.ranges.end(), [&](const Range& range) {
+            return range.offset == allocation.offset && !range.is_free;
+        });
+        if (it == block.ranges.end())
+        {
+            ERROR("Freeing memory that was not allocated from block %u.", allocation.block_index);
+            return;
+        }
+
+        // merge with free neighbours, the kind of a free range doesn't matter
+        it->is_free = true;
+        if (it + 1 != block.ranges.end() && (it + 1)->is_free)
+        {
+            it->size += (it + 1)->size;
+            block.ranges.erase(it + 1);
+        }
+        if (it != block.ranges.begin() && (it - 1)->is_free)
+        {
+            (it - 1)->size += it->size;
+            block.ranges.erase(it);
+        }
+
+        // an empty block is kept as long as it is the only one of its type, so that freeing the last resource and
+        // creating the next one doesn't hit the driver every time
+        bool is_empty = block.ranges.size() == 1;
+        if (is_empty)
+        {
+            bool has_other_block = std::any_of(m_blocks.begin(), m_blocks.end(), [&](const auto& other) {
+                return other != nullptr && other.get() != &block && other->memory_type_index == block.memory_type_index;
+            });
+            if (has_other_block)
+            {
+                vkFreeMemory(rhi.getDevice(), block.memory, nullptr);
+                m_blocks[allocation.block_index].reset();
+                DEBUG("  Released memory block");
+            }
+        }
+
+        allocation = {};
+    }
+
+    MemoryStatistics MemoryAllocator::getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        MemoryStatistics statistics;
+        statistics.dedicated_count = m_dedicated_count;
+        statistics.dedicated_bytes = m_dedicated_bytes;
+        for (const auto& block : m_blocks)
+        {
+            if (block == nullptr)
+                continue;
+
+            ++statistics.block_count;
+            statistics.block_bytes += block->size;
+            for (const Range& range : block->ranges)
+            {
+                if (range.is_free)
+                {
+                    ++statistics.free_range_count;
+                    statistics.largest_free_range = std::max(statistics.largest_free_range, range.size);
+                }
+                else
+                {
+                    ++statistics.allocation_count;
+                    statistics.used_bytes += range.size;
+                }
+            }
+        }
+
+        return statistics;
+    }
+
+    void MemoryAllocator::logStatistics() const
+    {
+        MemoryStatistics statistics = getStatistics();
+        INFO("GPU memory: %u blocks %.2f MB (%u allocations, %.2f MB used, %u free ranges, %.1f%% fragmented), "
+             "%u dedicated %.2f MB",
+             statistics.block_count,
+             statistics.block_bytes / (1024.0 * 1024.0),
+             statistics.allocation_count,
+             statistics.used_bytes / (1024.0 * 1024.0),
+             statistics.free_range_count,
+             statistics.getFragmentation() * 100.0f,
+             statistics.dedicated_count,
+             statistics.dedicated_bytes / (1024.0 * 1024.0));
+    }
+
+} // namespace Nano
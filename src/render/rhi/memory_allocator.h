@@ -0,0 +1,137 @@
+#ifndef MEMORY_ALLOCATOR_H
+#define MEMORY_ALLOCATOR_H
+
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Nano
+{
+    // What a sub-allocation holds. Linear and optimal resources sharing a bufferImageGranularity page would alias
+    // on some hardware, so the allocator keeps them on separate pages.
+    enum class MemoryResourceKind : uint8_t
+    {
+        Linear,  // buffers
+        Optimal, // images with VK_IMAGE_TILING_OPTIMAL
+    };
+
+    // A range of device memory handed out by the MemoryAllocator. Resources bind memory at offset.
+    struct MemoryAllocation
+    {
+        static constexpr uint32_t DEDICATED_BLOCK_INDEX {0xFFFFFFFFu};
+
+        VkDeviceMemory memory {VK_NULL_HANDLE};
+        VkDeviceSize   offset {0};
+        VkDeviceSize   size {0};
+        void*          mapped {nullptr}; // host visible memory stays mapped, already offset to the allocation
+        uint32_t       memory_type_index {0};
+        uint32_t       block_index {DEDICATED_BLOCK_INDEX};
+    };
+
+    struct MemoryStatistics
+    {
+        uint32_t     block_count {0};
+        uint32_t     dedicated_count {0};
+        uint32_t     allocation_count {0}; // sub-allocations in blocks
+        uint32_t     free_range_count {0};
+        VkDeviceSize block_bytes {0};
+        VkDeviceSize dedicated_bytes {0};
+        VkDeviceSize used_bytes {0}; // of the blocks
+        VkDeviceSize largest_free_range {0};
+
+        // 0 => all free block memory is one range, close to 1 => scattered over many small ones
+        float getFragmentation() const
+        {
+            VkDeviceSize free_bytes = block_bytes - used_bytes;
+            return free_bytes == 0 ? 0.0f : 1.0f - static_cast<float>(largest_free_range) / free_bytes;
+        }
+    };
+
+    // Sub-allocates Buffer and Texture memory from large VkDeviceMemory blocks per memory type, instead of one
+    // vkAllocateMemory per resource. Big resources and those the driver prefers dedicated memory for get their own
+    // allocation. Host visible blocks are mapped once for their whole lifetime.
+    class MemoryAllocator final
+    {
+    public:
+        static MemoryAllocator& instance()
+        {
+            static MemoryAllocator s_memory_allocator;
+            return s_memory_allocator;
+        }
+
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE {64ull * 1024 * 1024};
+
+        // Sub-allocates from a block of the first memory type with the properties, resources too big for that get
+        // dedicated memory.
+        bool allocate(const VkMemoryRequirements& requirements,
+                      VkMemoryPropertyFlags       property_flags,
+                      MemoryResourceKind          kind,
+                      MemoryAllocation&           out_allocation);
+        // Gives the allocation its own VkDeviceMemory. With an image or buffer it is tied to that resource by
+        // VkMemoryDedicatedAllocateInfo, as drivers prefer for e.g. render targets.
+        bool allocateDedicated(const VkMemoryRequirements& requirements,
+                               VkMemoryPropertyFlags       property_flags,
+                               MemoryAllocation&           out_allocation,
+                               VkImage                     image  = VK_NULL_HANDLE,
+                               VkBuffer                    buffer = VK_NULL_HANDLE);
+        // Resets the allocation, the GPU must be done with the resource bound to it.
+        void free(MemoryAllocation& allocation);
+
+        MemoryStatistics getStatistics() const;
+        void             logStatistics() const;
+
+    protected:
+        MemoryAllocator();
+        ~MemoryAllocator() noexcept;
+
+        MemoryAllocator(const MemoryAllocator&)            = delete;
+        MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+        MemoryAllocator(MemoryAllocator&&)                 = delete;
+        MemoryAllocator& operator=(MemoryAllocator&&)      = delete;
+
+    private:
+        // Consecutive ranges covering a whole block, sorted by offset. Neighbouring free ranges are always merged.
+        struct Range
+        {
+            VkDeviceSize       offset {0};
+            VkDeviceSize       size {0};
+            bool               is_free {true};
+            MemoryResourceKind kind {MemoryResourceKind::Linear};
+        };
+
+        struct Block
+        {
+            VkDeviceMemory     memory {VK_NULL_HANDLE};
+            VkDeviceSize       size {0};
+            uint32_t           memory_type_index {0};
+            void*              mapped {nullptr};
+            std::vector<Range> ranges;
+        };
+
+        bool allocateDeviceMemory(VkDeviceSize    size,
+                                  uint32_t        memory_type_index,
+                                  const void*     next,
+                                  VkDeviceMemory& out_memory,
+                                  void*&          out_mapped);
+        bool allocateDedicatedLocked(const VkMemoryRequirements& requirements,
+                                     uint32_t                    memory_type_index,
+                                     const void*                 next,
+                                     MemoryAllocation&           out_allocation);
+        bool allocateFromBlock(uint32_t                    block_index,
+                               const VkMemoryRequirements& requirements,
+                               MemoryResourceKind          kind,
+                               MemoryAllocation&           out_allocation);
+        VkDeviceSize getBlockSize(uint32_t memory_type_index) const;
+
+        mutable std::mutex                  m_mutex;
+        std::vector<std::unique_ptr<Block>> m_blocks; // freed blocks stay as empty slots, indices are stable
+        uint32_t                            m_dedicated_count {0};
+        VkDeviceSize                        m_dedicated_bytes {0};
+        VkDeviceSize                        m_buffer_image_granularity {1};
+    };
+
+} // namespace Nano
+
+#endif // !MEMORY_ALLOCATOR_H
@@ -219,6 +219,15 @@ namespace Nano
         {
             descriptor_set_layouts.push_back(create_info.descriptor_set_layout);
         }
+        if (create_info.bindless_set_layout != VK_NULL_HANDLE)
+        {
+            if (descriptor_set_layouts.empty())
+            {
+                ERROR("Bindless set layout needs a descriptor set layout in front of it.");
+                return false;
+            }
+            descriptor_set_layouts.push_back(create_info.bindless_set_layout);
+        }
 
         if (!createPipelineLayout(descriptor_set_layouts, create_info.push_constant_ranges))
         {
@@ -278,6 +287,15 @@ namespace Nano
         {
             descriptor_set_layouts.push_back(create_info.descriptor_set_layout);
         }
+        if (create_info.bindless_set_layout != VK_NULL_HANDLE)
+        {
+            if (descriptor_set_layouts.empty())
+            {
+                ERROR("Bindless set layout needs a descriptor set layout in front of it.");
+                return false;
+            }
+            descriptor_set_layouts.push_back(create_info.bindless_set_layout);
+        }
 
         if (!createPipelineLayout(descriptor_set_layouts, create_info.push_constant_ranges))
         {
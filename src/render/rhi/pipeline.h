@@ -50,6 +50,8 @@ namespace Nano
 
         // descriptor set layout
         VkDescriptorSetLayout descriptor_set_layout {VK_NULL_HANDLE};
+        // BindlessHeap::getLayout(), set 1 after descriptor_set_layout
+        VkDescriptorSetLayout bindless_set_layout {VK_NULL_HANDLE};
 
         // push constants
         std::vector<VkPushConstantRange> push_constant_ranges;
@@ -61,6 +63,8 @@ namespace Nano
 
         // descriptor set layout
         VkDescriptorSetLayout descriptor_set_layout {VK_NULL_HANDLE};
+        // BindlessHeap::getLayout(), set 1 after descriptor_set_layout
+        VkDescriptorSetLayout bindless_set_layout {VK_NULL_HANDLE};
 
         // push constants
         std::vector<VkPushConstantRange> push_constant_ranges;
@@ -0,0 +1,203 @@
+#include "resource_state.h"
+#include "buffer.h"
+#include "misc/logger.h"
+#include "rhi.h"
+#include "texture.h"
+
+namespace Nano
+{
+    // Moves the state past the next access and returns the source scope the access has to wait for, false when it
+    // is already ordered and visible. Visibility is tracked as the union of the stages and accesses that read since
+    // the last write.
+    static bool resolveAccess(ResourceState&            state,
+                              VkPipelineStageFlags2KHR  stages,
+                              VkAccessFlags2KHR         access,
+                              bool                      is_layout_transition,
+                              VkPipelineStageFlags2KHR& src_stages,
+                              VkAccessFlags2KHR&        src_access)
+    {
+        bool is_write = (access & BarrierBatch::WRITE_ACCESS_MASK) != 0;
+
+        if (is_write || is_layout_transition)
+        {
+            // WAW needs the last write to be available, WAR only has to wait for the readers
+            src_stages = state.write_stages | state.read_stages;
+            src_access = state.write_access;
+
+            // a transition is itself a write, later readers in other stages have to wait for it
+            state.write_stages = stages;
+            state.write_access = access & BarrierBatch::WRITE_ACCESS_MASK;
+            state.read_stages  = is_write ? VK_PIPELINE_STAGE_2_NONE_KHR : stages;
+            state.read_access  = is_write ? VK_ACCESS_2_NONE_KHR : access;
+            return src_stages != VK_PIPELINE_STAGE_2_NONE_KHR || is_layout_transition;
+        }
+
+        if (state.write_stages == VK_PIPELINE_STAGE_2_NONE_KHR)
+        {
+            // never written on the GPU, e.g. filled from the host before the first submission
+            state.read_stages |= stages;
+            state.read_access |= access;
+            return false;
+        }
+
+        if ((stages & ~state.read_stages) == 0 && (access & ~state.read_access) == 0)
+        {
+            return false;
+        }
+
+        src_stages = state.write_stages;
+        src_access = state.write_access;
+        state.read_stages |= stages;
+        state.read_access |= access;
+        return true;
+    }
+
+    void BarrierBatch::access(Buffer* buffer, VkPipelineStageFlags2KHR stages, VkAccessFlags2KHR access)
+    {
+        if (buffer == nullptr)
+        {
+            return;
+        }
+
+        for (BufferAccess& buffer_access : m_buffer_accesses)
+        {
+            if (buffer_access.buffer == buffer)
+            {
+                buffer_access.stages |= stages;
+                buffer_access.access |= access;
+                return;
+            }
+        }
+
+        m_buffer_accesses.push_back({buffer, stages, access});
+    }
+
+    void BarrierBatch::access(Texture*                 texture,
+                              VkImageLayout            layout,
+                              VkPipelineStageFlags2KHR stages,
+                              VkAccessFlags2KHR        access)
+    {
+        if (texture == nullptr)
+        {
+            return;
+        }
+
+        for (TextureAccess& texture_access : m_texture_accesses)
+        {
+            if (texture_access.texture == texture)
+            {
+                if (texture_access.layout != layout)
+                {
+                    ERROR("Texture accessed in two layouts by the same commands.");
+                }
+                texture_access.stages |= stages;
+                texture_access.access |= access;
+                return;
+            }
+        }
+
+        m_texture_accesses.push_back({texture, layout, stages, access});
+    }
+
+    void BarrierBatch::access(const ResourceAccess& resource_access)
+    {
+        if (resource_access.buffer != nullptr)
+        {
+            access(resource_access.buffer, resource_access.stages, resource_access.access);
+        }
+        else
+        {
+            access(resource_access.texture, resource_access.layout, resource_access.stages, resource_access.access);
+        }
+    }
+
+    bool BarrierBatch::flush(VkCommandBuffer cmd)
+    {
+        m_buffer_barriers.clear();
+        m_image_barriers.clear();
+
+        for (const BufferAccess& buffer_access : m_buffer_accesses)
+        {
+            VkPipelineStageFlags2KHR src_stages = VK_PIPELINE_STAGE_2_NONE_KHR;
+            VkAccessFlags2KHR        src_access = VK_ACCESS_2_NONE_KHR;
+            if (!resolveAccess(buffer_access.buffer->getState(),
+                               buffer_access.stages,
+                               buffer_access.access,
+                               false,
+                               src_stages,
+                               src_access))
+            {
+                continue;
+            }
+
+            VkBufferMemoryBarrier2KHR barrier = {};
+            barrier.sType                     = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR;
+            barrier.srcStageMask              = src_stages;
+            barrier.srcAccessMask             = src_access;
+            barrier.dstStageMask              = buffer_access.stages;
+            barrier.dstAccessMask             = buffer_access.access;
+            barrier.srcQueueFamilyIndex       = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex       = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer                    = buffer_access.buffer->getBuffer();
+            barrier.offset                    = 0;
+            barrier.size                      = VK_WHOLE_SIZE;
+            m_buffer_barriers.push_back(barrier);
+        }
+
+        for (const TextureAccess& texture_access : m_texture_accesses)
+        {
+            ResourceState& state      = texture_access.texture->getState();
+            VkImageLayout  old_layout = state.layout;
+
+            VkPipelineStageFlags2KHR src_stages = VK_PIPELINE_STAGE_2_NONE_KHR;
+            VkAccessFlags2KHR        src_access = VK_ACCESS_2_NONE_KHR;
+            if (!resolveAccess(state,
+                               texture_access.stages,
+                               texture_access.access,
+                               old_layout != texture_access.layout,
+                               src_stages,
+                               src_access))
+            {
+                continue;
+            }
+            state.layout = texture_access.layout;
+
+            VkImageMemoryBarrier2KHR barrier        = {};
+            barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+            barrier.srcStageMask                    = src_stages;
+            barrier.srcAccessMask                   = src_access;
+            barrier.dstStageMask                    = texture_access.stages;
+            barrier.dstAccessMask                   = texture_access.access;
+            barrier.oldLayout                       = old_layout;
+            barrier.newLayout                       = texture_access.layout;
+            barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image                           = texture_access.texture->getImage();
+            barrier.subresourceRange.aspectMask     = texture_access.texture->getAspectFlags();
+            barrier.subresourceRange.baseMipLevel   = 0;
+            barrier.subresourceRange.levelCount     = VK_REMAINING_MIP_LEVELS;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount     = VK_REMAINING_ARRAY_LAYERS;
+            m_image_barriers.push_back(barrier);
+        }
+
+        m_buffer_accesses.clear();
+        m_texture_accesses.clear();
+
+        if (m_buffer_barriers.empty() && m_image_barriers.empty())
+        {
+            return false;
+        }
+
+        VkDependencyInfoKHR dependency_info      = {};
+        dependency_info.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+        dependency_info.bufferMemoryBarrierCount = static_cast<uint32_t>(m_buffer_barriers.size());
+        dependency_info.pBufferMemoryBarriers    = m_buffer_barriers.data();
+        dependency_info.imageMemoryBarrierCount  = static_cast<uint32_t>(m_image_barriers.size());
+        dependency_info.pImageMemoryBarriers     = m_image_barriers.data();
+
+        RHI::instance().cmdPipelineBarrier2(cmd, dependency_info);
+        return true;
+    }
+
+} // namespace Nano
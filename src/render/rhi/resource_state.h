@@ -0,0 +1,77 @@
+#ifndef RESOURCE_STATE_H
+#define RESOURCE_STATE_H
+
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <vector>
+
+namespace Nano
+{
+    class Buffer;
+    class Texture;
+
+    // Last GPU accesses of a buffer or image, tracked on the CPU in recording order. Submissions on one queue
+    // execute in that order too, so the state carries over from one command buffer to the next.
+    struct ResourceState
+    {
+        VkPipelineStageFlags2KHR write_stages {VK_PIPELINE_STAGE_2_NONE_KHR}; // of the last write
+        VkAccessFlags2KHR        write_access {VK_ACCESS_2_NONE_KHR};
+        VkPipelineStageFlags2KHR read_stages {VK_PIPELINE_STAGE_2_NONE_KHR}; // reading since the last write
+        VkAccessFlags2KHR        read_access {VK_ACCESS_2_NONE_KHR};         // the last write is visible to
+        VkImageLayout            layout {VK_IMAGE_LAYOUT_UNDEFINED};
+    };
+
+    // One access of either a buffer or a texture, e.g. a binding of a RenderPass.
+    struct ResourceAccess
+    {
+        Buffer*                  buffer {nullptr};
+        Texture*                 texture {nullptr};
+        VkImageLayout            layout {VK_IMAGE_LAYOUT_UNDEFINED};
+        VkPipelineStageFlags2KHR stages {VK_PIPELINE_STAGE_2_NONE_KHR};
+        VkAccessFlags2KHR        access {VK_ACCESS_2_NONE_KHR};
+    };
+
+    // Collects the accesses the next commands make and turns them into the barriers they need against the tracked
+    // state of each resource. Accesses to the same resource are merged, flush() records them all with one
+    // vkCmdPipelineBarrier2 and skips resources that need no synchronization.
+    class BarrierBatch
+    {
+    public:
+        static constexpr VkAccessFlags2KHR WRITE_ACCESS_MASK =
+            VK_ACCESS_2_SHADER_WRITE_BIT_KHR | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR |
+            VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR |
+            VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR | VK_ACCESS_2_HOST_WRITE_BIT_KHR | VK_ACCESS_2_MEMORY_WRITE_BIT_KHR;
+
+        void access(Buffer* buffer, VkPipelineStageFlags2KHR stages, VkAccessFlags2KHR access);
+        void access(Texture* texture, VkImageLayout layout, VkPipelineStageFlags2KHR stages, VkAccessFlags2KHR access);
+        void access(const ResourceAccess& resource_access);
+
+        // Returns whether a barrier was recorded, the batch is empty afterwards either way.
+        bool flush(VkCommandBuffer cmd);
+
+    private:
+        struct BufferAccess
+        {
+            Buffer*                  buffer {nullptr};
+            VkPipelineStageFlags2KHR stages {VK_PIPELINE_STAGE_2_NONE_KHR};
+            VkAccessFlags2KHR        access {VK_ACCESS_2_NONE_KHR};
+        };
+
+        struct TextureAccess
+        {
+            Texture*                 texture {nullptr};
+            VkImageLayout            layout {VK_IMAGE_LAYOUT_UNDEFINED};
+            VkPipelineStageFlags2KHR stages {VK_PIPELINE_STAGE_2_NONE_KHR};
+            VkAccessFlags2KHR        access {VK_ACCESS_2_NONE_KHR};
+        };
+
+        std::vector<BufferAccess>  m_buffer_accesses;
+        std::vector<TextureAccess> m_texture_accesses;
+
+        std::vector<VkBufferMemoryBarrier2KHR> m_buffer_barriers;
+        std::vector<VkImageMemoryBarrier2KHR>  m_image_barriers;
+    };
+
+} // namespace Nano
+
+#endif // !RESOURCE_STATE_H
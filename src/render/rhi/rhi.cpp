@@ -1,6 +1,7 @@
 #include "rhi.h"
 #include <vulkan/vk_platform.h>
 #include <vulkan/vulkan_core.h>
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
@@ -10,6 +11,8 @@
 
 namespace Nano
 {
+    static bool s_is_headless_requested {false};
+    static bool s_is_bindless_requested {false};
 
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugReportFlagsEXT      flags,
                                                         VkDebugReportObjectTypeEXT objectType,
@@ -159,7 +162,12 @@ namespace Nano
         return VK_FALSE;
     }
 
+    void RHI::setHeadless(bool is_headless) { s_is_headless_requested = is_headless; }
+
+    void RHI::setBindless(bool is_bindless) { s_is_bindless_requested = is_bindless; }
+
     RHI::RHI()
+        : m_is_headless(s_is_headless_requested), m_is_bindless(s_is_bindless_requested)
     {
         if (initInstance() == false)
             FATAL("Failed when init vulkan instance.");
@@ -169,9 +177,12 @@ namespace Nano
             WARN("Failed when init vulkan debugger.");
         DEBUG("Successfully initialize or ignore vulkan debugger.");
 
-        if (initSurface() == false)
+        if (m_is_headless)
+            INFO("Running headless, no surface is created.");
+        else if (initSurface() == false)
             FATAL("Failed when init vulkan surface");
-        DEBUG("Successfully initialize vulkan surface.");
+        else
+            DEBUG("Successfully initialize vulkan surface.");
 
         if (initPhysicalDevice() == false)
             FATAL("Failed when init vulkan physical device");
@@ -181,9 +192,12 @@ namespace Nano
             FATAL("Failed when init vulkan logical device");
         DEBUG("Successfully initialize vulkan logical device.");
 
-        if (initSurfaceProperties() == false)
-            FATAL("Failed when init vulkan surface properties");
-        DEBUG("Successfully initialize vulkan surface properties.");
+        if (!m_is_headless)
+        {
+            if (initSurfaceProperties() == false)
+                FATAL("Failed when init vulkan surface properties");
+            DEBUG("Successfully initialize vulkan surface properties.");
+        }
     }
 
     RHI::~RHI() noexcept
@@ -191,6 +205,18 @@ namespace Nano
         if (m_device != VK_NULL_HANDLE)
         {
             vkDeviceWaitIdle(m_device);
+
+            for (VkSemaphore& timeline : m_timelines)
+            {
+                if (timeline != VK_NULL_HANDLE)
+                {
+                    vkDestroySemaphore(m_device, timeline, nullptr);
+                    timeline = VK_NULL_HANDLE;
+
+                    DEBUG("  Destroyed timeline semaphore");
+                }
+            }
+
             vkDestroyDevice(m_device, nullptr);
             m_device = VK_NULL_HANDLE;
 
@@ -257,13 +283,17 @@ namespace Nano
 
     bool RHI::initInstance()
     {
-        // glfw exts
+        // glfw exts, only needed to create the window surface
         uint32_t     glfw_ext_count = 0;
-        const char** glfw_exts      = glfwGetRequiredInstanceExtensions(&glfw_ext_count);
-        if (!glfw_exts)
+        const char** glfw_exts      = nullptr;
+        if (!m_is_headless)
         {
-            ERROR("Failed to get GLFW required instance extensions");
-            return false;
+            glfw_exts = glfwGetRequiredInstanceExtensions(&glfw_ext_count);
+            if (!glfw_exts)
+            {
+                ERROR("Failed to get GLFW required instance extensions");
+                return false;
+            }
         }
 
         // additional exts
@@ -364,6 +394,25 @@ namespace Nano
         return true;
     }
 
+    // Family with the required flags and none of the excluded ones, so its queue runs beside the excluded ones.
+    static uint32_t findDedicatedQueueFamily(const VkQueueFamilyProperties* queue_family_props,
+                                             uint32_t                       queue_family_count,
+                                             VkQueueFlags                   required_flags,
+                                             VkQueueFlags                   excluded_flags,
+                                             uint32_t                       fallback_index)
+    {
+        for (uint32_t i = 0; i < queue_family_count; ++i)
+        {
+            VkQueueFlags flags = queue_family_props[i].queueFlags;
+            if (queue_family_props[i].queueCount > 0 && (flags & required_flags) == required_flags &&
+                (flags & excluded_flags) == 0)
+            {
+                return i;
+            }
+        }
+        return fallback_index;
+    }
+
     bool RHI::initPhysicalDevice()
     {
         uint32_t device_cnt = 0;
@@ -431,8 +480,12 @@ namespace Nano
                     device_queue_family_props[j].queueFlags & VK_QUEUE_GRAPHICS_BIT)
                     graphic_queue_family_index = j;
 
+                // headless there is nothing to present, the graphics family stands in for the present one
                 VkBool32 support_present = false;
-                vkGetPhysicalDeviceSurfaceSupportKHR(curr_device, j, m_surface, &support_present);
+                if (m_is_headless)
+                    present_queue_family_index = graphic_queue_family_index;
+                else
+                    vkGetPhysicalDeviceSurfaceSupportKHR(curr_device, j, m_surface, &support_present);
                 if (support_present && device_queue_family_props[j].queueCount > 0)
                     present_queue_family_index = j;
 
@@ -441,6 +494,25 @@ namespace Nano
                     m_physical_device            = curr_device;
                     m_graphic_queue_family_index = static_cast<uint32_t>(graphic_queue_family_index);
                     m_present_queue_family_index = static_cast<uint32_t>(present_queue_family_index);
+
+                    // transfer prefers a family without compute either, copy engines run beside both queues
+                    m_compute_queue_family_index  = findDedicatedQueueFamily(device_queue_family_props,
+                                                                            device_queue_family_prop_cnt,
+                                                                            VK_QUEUE_COMPUTE_BIT,
+                                                                            VK_QUEUE_GRAPHICS_BIT,
+                                                                            m_graphic_queue_family_index);
+                    m_transfer_queue_family_index = findDedicatedQueueFamily(device_queue_family_props,
+                                                                             device_queue_family_prop_cnt,
+                                                                             VK_QUEUE_TRANSFER_BIT,
+                                                                             VK_QUEUE_GRAPHICS_BIT |
+                                                                                 VK_QUEUE_COMPUTE_BIT,
+                                                                             m_compute_queue_family_index);
+                    DEBUG("  Queue families : graphics %u, present %u, compute %u, transfer %u",
+                          m_graphic_queue_family_index,
+                          m_present_queue_family_index,
+                          m_compute_queue_family_index,
+                          m_transfer_queue_family_index);
+
                     delete[] device_queue_family_props;
                     delete[] devices;
                     return true;
@@ -457,38 +529,52 @@ namespace Nano
 
     bool RHI::initLogicalDevice()
     {
-        VkDeviceQueueCreateInfo vkDeviceQueueCreateInfos[2];
-        float                   p                     = 1.0f;
-        int                     queue_create_info_cnt = 2;
-        if (m_graphic_queue_family_index == m_present_queue_family_index)
-        {
-            vkDeviceQueueCreateInfos[0]                  = {};
-            vkDeviceQueueCreateInfos[0].sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-            vkDeviceQueueCreateInfos[0].queueFamilyIndex = m_graphic_queue_family_index;
-            vkDeviceQueueCreateInfos[0].queueCount       = 1;
-            vkDeviceQueueCreateInfos[0].pQueuePriorities = &p;
-            queue_create_info_cnt                        = 1;
+        // one queue per distinct family, queues of a shared family are the same VkQueue
+        const uint32_t queue_family_indices[] = {m_graphic_queue_family_index,
+                                                 m_present_queue_family_index,
+                                                 m_compute_queue_family_index,
+                                                 m_transfer_queue_family_index};
+
+        std::vector<VkDeviceQueueCreateInfo> vkDeviceQueueCreateInfos;
+        float                                p = 1.0f;
+        for (uint32_t queue_family_index : queue_family_indices)
+        {
+            bool is_created = false;
+            for (const VkDeviceQueueCreateInfo& queue_create_info : vkDeviceQueueCreateInfos)
+            {
+                is_created |= queue_create_info.queueFamilyIndex == queue_family_index;
+            }
+            if (is_created)
+                continue;
+
+            VkDeviceQueueCreateInfo queue_create_info = {};
+            queue_create_info.sType                   = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queue_create_info.queueFamilyIndex        = queue_family_index;
+            queue_create_info.queueCount              = 1;
+            queue_create_info.pQueuePriorities        = &p;
+            vkDeviceQueueCreateInfos.push_back(queue_create_info);
         }
-        else
+
+        m_shared_queue_family_indices.clear();
+        for (uint32_t queue_family_index :
+             {m_graphic_queue_family_index, m_compute_queue_family_index, m_transfer_queue_family_index})
         {
-            vkDeviceQueueCreateInfos[0]                  = {};
-            vkDeviceQueueCreateInfos[0].sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-            vkDeviceQueueCreateInfos[0].queueFamilyIndex = m_graphic_queue_family_index;
-            vkDeviceQueueCreateInfos[0].queueCount       = 1;
-            vkDeviceQueueCreateInfos[0].pQueuePriorities = &p;
-            vkDeviceQueueCreateInfos[1]                  = {};
-            vkDeviceQueueCreateInfos[1].sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-            vkDeviceQueueCreateInfos[1].queueFamilyIndex = m_present_queue_family_index;
-            vkDeviceQueueCreateInfos[1].queueCount       = 1;
-            vkDeviceQueueCreateInfos[1].pQueuePriorities = &p;
-            queue_create_info_cnt                        = 2;
+            if (std::find(m_shared_queue_family_indices.begin(),
+                          m_shared_queue_family_indices.end(),
+                          queue_family_index) == m_shared_queue_family_indices.end())
+            {
+                m_shared_queue_family_indices.push_back(queue_family_index);
+            }
         }
 
+        VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2_features = {};
+        synchronization2_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+        VkPhysicalDeviceVulkan12Features vulkan12_features = {};
+        vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan12_features.pNext = &synchronization2_features;
         VkPhysicalDeviceFeatures2 features2 = {};
         features2.sType                     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
-        VkPhysicalDeviceShaderAtomicInt64Features shader_atomic_i64_features = {};
-        shader_atomic_i64_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_ATOMIC_INT64_FEATURES;
-        features2.pNext                  = &shader_atomic_i64_features;
+        features2.pNext                     = &vulkan12_features;
         vkGetPhysicalDeviceFeatures2(m_physical_device, &features2);
 
         bool support_shader_i64 = features2.features.shaderInt64;
@@ -497,12 +583,82 @@ namespace Nano
             ERROR("Device not support int64 type in shader.");
             return false;
         }
-        bool support_buffer_i64_atomics = shader_atomic_i64_features.shaderBufferInt64Atomics;
+        bool support_buffer_i64_atomics = vulkan12_features.shaderBufferInt64Atomics;
         if (!support_buffer_i64_atomics)
         {
             ERROR("Device not support int64 atomic type in buffer.");
             return false;
         }
+        if (!features2.features.multiDrawIndirect)
+        {
+            ERROR("Device not support multi draw indirect.");
+            return false;
+        }
+        if (!features2.features.drawIndirectFirstInstance)
+        {
+            ERROR("Device not support first instance in indirect draws.");
+            return false;
+        }
+        if (!vulkan12_features.drawIndirectCount)
+        {
+            ERROR("Device not support draw indirect count.");
+            return false;
+        }
+        if (!vulkan12_features.timelineSemaphore)
+        {
+            ERROR("Device not support timeline semaphore.");
+            return false;
+        }
+        if (!synchronization2_features.synchronization2)
+        {
+            ERROR("Device not support synchronization2.");
+            return false;
+        }
+        // the bindless heap is optional, without descriptor indexing every pass keeps to its own set
+        if (m_is_bindless &&
+            (!vulkan12_features.descriptorIndexing || !vulkan12_features.runtimeDescriptorArray ||
+             !vulkan12_features.descriptorBindingPartiallyBound ||
+             !vulkan12_features.descriptorBindingUpdateUnusedWhilePending ||
+             !vulkan12_features.descriptorBindingStorageBufferUpdateAfterBind ||
+             !vulkan12_features.descriptorBindingSampledImageUpdateAfterBind ||
+             !vulkan12_features.descriptorBindingStorageImageUpdateAfterBind ||
+             !vulkan12_features.shaderStorageBufferArrayNonUniformIndexing ||
+             !vulkan12_features.shaderSampledImageArrayNonUniformIndexing ||
+             !vulkan12_features.shaderStorageImageArrayNonUniformIndexing))
+        {
+            WARN("Device not support descriptor indexing, bindless heap is disabled.");
+            m_is_bindless = false;
+        }
+
+        // enable only what the renderer relies on
+        VkPhysicalDeviceVulkan12Features enabled_vulkan12_features = {};
+        enabled_vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        enabled_vulkan12_features.shaderBufferInt64Atomics = VK_TRUE;
+        enabled_vulkan12_features.drawIndirectCount        = VK_TRUE;
+        enabled_vulkan12_features.timelineSemaphore        = VK_TRUE;
+        if (m_is_bindless)
+        {
+            enabled_vulkan12_features.descriptorIndexing                            = VK_TRUE;
+            enabled_vulkan12_features.runtimeDescriptorArray                        = VK_TRUE;
+            enabled_vulkan12_features.descriptorBindingPartiallyBound               = VK_TRUE;
+            enabled_vulkan12_features.descriptorBindingUpdateUnusedWhilePending     = VK_TRUE;
+            enabled_vulkan12_features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+            enabled_vulkan12_features.descriptorBindingSampledImageUpdateAfterBind  = VK_TRUE;
+            enabled_vulkan12_features.descriptorBindingStorageImageUpdateAfterBind  = VK_TRUE;
+            enabled_vulkan12_features.shaderStorageBufferArrayNonUniformIndexing    = VK_TRUE;
+            enabled_vulkan12_features.shaderSampledImageArrayNonUniformIndexing     = VK_TRUE;
+            enabled_vulkan12_features.shaderStorageImageArrayNonUniformIndexing     = VK_TRUE;
+        }
+        VkPhysicalDeviceSynchronization2FeaturesKHR enabled_synchronization2_features = {};
+        enabled_synchronization2_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+        enabled_synchronization2_features.synchronization2 = VK_TRUE;
+        enabled_vulkan12_features.pNext                    = &enabled_synchronization2_features;
+        VkPhysicalDeviceFeatures2 enabled_features2        = {};
+        enabled_features2.sType                            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        enabled_features2.pNext                            = &enabled_vulkan12_features;
+        enabled_features2.features.shaderInt64             = VK_TRUE;
+        enabled_features2.features.multiDrawIndirect       = VK_TRUE;
+        enabled_features2.features.drawIndirectFirstInstance = VK_TRUE;
 
         vkGetPhysicalDeviceMemoryProperties(m_physical_device, &m_memory_properties);
 
@@ -511,29 +667,32 @@ namespace Nano
         m_device_extensions.resize(extension_count);
         vkEnumerateDeviceExtensionProperties(m_physical_device, nullptr, &extension_count, m_device_extensions.data());
 
-        const char*    required_exts[]    = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
-        const uint32_t required_ext_count = sizeof(required_exts) / sizeof(required_exts[0]);
-        for (uint32_t i = 0; i < required_ext_count; ++i)
+        // software drivers in CI containers don't have to offer a swapchain
+        std::vector<const char*> required_exts = {VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME};
+        if (!m_is_headless)
+            required_exts.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        for (const char* required_ext : required_exts)
         {
-            if (!isDeviceExtensionSupported(required_exts[i]))
+            if (!isDeviceExtensionSupported(required_ext))
             {
-                ERROR("Device does not support required extension: %s", required_exts[i]);
+                ERROR("Device does not support required extension: %s", required_ext);
                 return false;
             }
         }
 
         VkDeviceCreateInfo vkDeviceCreateInfo   = {};
         vkDeviceCreateInfo.sType                = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        vkDeviceCreateInfo.queueCreateInfoCount = queue_create_info_cnt;
-        vkDeviceCreateInfo.pQueueCreateInfos    = vkDeviceQueueCreateInfos;
+        vkDeviceCreateInfo.pNext                = &enabled_features2;
+        vkDeviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(vkDeviceQueueCreateInfos.size());
+        vkDeviceCreateInfo.pQueueCreateInfos    = vkDeviceQueueCreateInfos.data();
 
 #ifdef DEBUG
         vkDeviceCreateInfo.enabledLayerCount   = m_prefered_layer_cnt;
         vkDeviceCreateInfo.ppEnabledLayerNames = m_prefered_layers;
 #endif // DEBUG
 
-        vkDeviceCreateInfo.enabledExtensionCount   = required_ext_count;
-        vkDeviceCreateInfo.ppEnabledExtensionNames = required_exts;
+        vkDeviceCreateInfo.enabledExtensionCount   = static_cast<uint32_t>(required_exts.size());
+        vkDeviceCreateInfo.ppEnabledExtensionNames = required_exts.data();
 
         if (vkCreateDevice(m_physical_device, &vkDeviceCreateInfo, nullptr, &m_device) != VK_SUCCESS)
         {
@@ -542,6 +701,25 @@ namespace Nano
 
         vkGetDeviceQueue(m_device, m_graphic_queue_family_index, 0, &m_graphic_queue);
         vkGetDeviceQueue(m_device, m_present_queue_family_index, 0, &m_present_queue);
+        vkGetDeviceQueue(m_device, m_compute_queue_family_index, 0, &m_compute_queue);
+        vkGetDeviceQueue(m_device, m_transfer_queue_family_index, 0, &m_transfer_queue);
+
+        m_vkCmdPipelineBarrier2KHR = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(
+            vkGetDeviceProcAddr(m_device, "vkCmdPipelineBarrier2KHR"));
+        if (m_vkCmdPipelineBarrier2KHR == VK_NULL_HANDLE)
+        {
+            ERROR("Failed to load vkCmdPipelineBarrier2KHR.");
+            return false;
+        }
+
+        for (uint32_t queue_type = 0; queue_type < QUEUE_TYPE_COUNT; ++queue_type)
+        {
+            if (!createTimelineSemaphore(m_timeline_values[queue_type], m_timelines[queue_type]))
+            {
+                ERROR("Failed to create timeline semaphore.");
+                return false;
+            }
+        }
 
         return true;
     }
@@ -577,6 +755,72 @@ namespace Nano
         return false;
     }
 
+    VkQueue RHI::getQueue(QueueType queue_type) const
+    {
+        switch (queue_type)
+        {
+            case QueueType::Compute:
+                return m_compute_queue;
+            case QueueType::Transfer:
+                return m_transfer_queue;
+            default:
+                return m_graphic_queue;
+        }
+    }
+
+    uint32_t RHI::getQueueFamilyIndex(QueueType queue_type) const
+    {
+        switch (queue_type)
+        {
+            case QueueType::Compute:
+                return m_compute_queue_family_index;
+            case QueueType::Transfer:
+                return m_transfer_queue_family_index;
+            default:
+                return m_graphic_queue_family_index;
+        }
+    }
+
+    bool RHI::createTimelineSemaphore(uint64_t initial_value, VkSemaphore& out_semaphore) const
+    {
+        VkSemaphoreTypeCreateInfo type_info = {};
+        type_info.sType                     = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        type_info.semaphoreType             = VK_SEMAPHORE_TYPE_TIMELINE;
+        type_info.initialValue              = initial_value;
+
+        VkSemaphoreCreateInfo semaphore_info = {};
+        semaphore_info.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphore_info.pNext                 = &type_info;
+
+        return vkCreateSemaphore(m_device, &semaphore_info, nullptr, &out_semaphore) == VK_SUCCESS;
+    }
+
+    uint64_t RHI::getTimelineValue(VkSemaphore timeline) const
+    {
+        uint64_t value = 0;
+        if (vkGetSemaphoreCounterValue(m_device, timeline, &value) != VK_SUCCESS)
+        {
+            ERROR("Failed to query timeline semaphore value.");
+        }
+        return value;
+    }
+
+    bool RHI::waitTimelineValue(VkSemaphore timeline, uint64_t value, uint64_t timeout) const
+    {
+        VkSemaphoreWaitInfo wait_info = {};
+        wait_info.sType               = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        wait_info.semaphoreCount      = 1;
+        wait_info.pSemaphores         = &timeline;
+        wait_info.pValues             = &value;
+
+        VkResult result = vkWaitSemaphores(m_device, &wait_info, timeout);
+        if (result != VK_SUCCESS && result != VK_TIMEOUT)
+        {
+            ERROR("Failed to wait for timeline semaphore.");
+        }
+        return result == VK_SUCCESS;
+    }
+
     bool RHI::isDeviceExtensionSupported(const char* extension_name) const
     {
         for (const auto& ext : m_device_extensions)
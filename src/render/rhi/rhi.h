@@ -7,6 +7,17 @@
 
 namespace Nano
 {
+    // Queues work can be submitted to. Compute and transfer fall back to the graphics queue family when the device
+    // has no family dedicated to them.
+    enum class QueueType : uint32_t
+    {
+        Graphics,
+        Compute,
+        Transfer
+    };
+
+    static constexpr uint32_t QUEUE_TYPE_COUNT {3};
+
     class RHI final
     {
     public:
@@ -16,13 +27,34 @@ namespace Nano
             return s_rhi;
         }
 
+        // Has to be called before the first instance(). A headless RHI creates no surface and needs neither a
+        // present queue nor VK_KHR_swapchain, so it runs without a window, e.g. on lavapipe in a CI container.
+        static void setHeadless(bool is_headless);
+        bool        isHeadless() const { return m_is_headless; }
+        // Has to be called before the first instance() as well. Enables the descriptor indexing features the
+        // BindlessHeap needs, isBindless() stays false if the device lacks them.
+        static void setBindless(bool is_bindless);
+        bool        isBindless() const { return m_is_bindless; }
+
         VkDevice         getDevice() const { return m_device; }
         VkPhysicalDevice getPhysicalDevice() const { return m_physical_device; }
         VkQueue          getGraphicsQueue() const { return m_graphic_queue; }
         VkQueue          getPresentQueue() const { return m_present_queue; }
+        VkQueue          getComputeQueue() const { return m_compute_queue; }
+        VkQueue          getTransferQueue() const { return m_transfer_queue; }
+        VkQueue          getQueue(QueueType queue_type) const;
         VkSurfaceKHR     getSurface() const { return m_surface; }
         uint32_t         getGraphicsQueueFamilyIndex() const { return m_graphic_queue_family_index; }
         uint32_t         getPresentQueueFamilyIndex() const { return m_present_queue_family_index; }
+        uint32_t         getComputeQueueFamilyIndex() const { return m_compute_queue_family_index; }
+        uint32_t         getTransferQueueFamilyIndex() const { return m_transfer_queue_family_index; }
+        uint32_t         getQueueFamilyIndex(QueueType queue_type) const;
+
+        // Whether compute submissions can run concurrently with graphics ones, i.e. come from another family.
+        bool hasAsyncCompute() const { return m_compute_queue_family_index != m_graphic_queue_family_index; }
+        // Distinct families of the graphics, compute and transfer queues. Buffers are shared between them with
+        // VK_SHARING_MODE_CONCURRENT, so they need no queue family ownership transfers.
+        const std::vector<uint32_t>& getSharedQueueFamilyIndices() const { return m_shared_queue_family_indices; }
 
         const VkSurfaceCapabilitiesKHR& getSurfaceCapabilities() const { return m_surface_capabilities; }
         uint32_t                        getSurfaceFormatCount() const { return m_surface_format_cnt; }
@@ -30,9 +62,38 @@ namespace Nano
         uint32_t                        getSurfacePresentModeCount() const { return m_surface_present_mode_cnt; }
         const VkPresentModeKHR*         getSurfacePresentModes() const { return m_surface_present_modes; }
 
+        const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const { return m_memory_properties; }
+
         bool
         findMemoryType(uint32_t type_filter, VkMemoryPropertyFlags property_flags, uint32_t& memory_type_index) const;
 
+        // vkCmdPipelineBarrier2 of VK_KHR_synchronization2, the device is created with the extension enabled.
+        void cmdPipelineBarrier2(VkCommandBuffer cmd, const VkDependencyInfoKHR& dependency_info) const
+        {
+            m_vkCmdPipelineBarrier2KHR(cmd, &dependency_info);
+        }
+
+        // Timeline semaphore signaled by the submissions to a queue, see CommandBuffer::submitTimeline().
+        VkSemaphore getTimeline(QueueType queue_type) const { return m_timelines[static_cast<uint32_t>(queue_type)]; }
+        VkSemaphore getGraphicsTimeline() const { return getTimeline(QueueType::Graphics); }
+        // Reserves the value the next submission to the queue signals. Values have to reach the queue in
+        // reservation order, so reserve right before submitting and from the submitting thread only.
+        uint64_t reserveTimelineValue(QueueType queue_type)
+        {
+            return ++m_timeline_values[static_cast<uint32_t>(queue_type)];
+        }
+        uint64_t reserveGraphicsTimelineValue() { return reserveTimelineValue(QueueType::Graphics); }
+
+        bool createTimelineSemaphore(uint64_t initial_value, VkSemaphore& out_semaphore) const;
+        // Last value the GPU signaled, never blocks.
+        uint64_t getTimelineValue(VkSemaphore timeline) const;
+        bool     isTimelineValueReached(VkSemaphore timeline, uint64_t value) const
+        {
+            return getTimelineValue(timeline) >= value;
+        }
+        // Blocks until the timeline reaches value, false on timeout or device loss. A zero timeout only polls.
+        bool waitTimelineValue(VkSemaphore timeline, uint64_t value, uint64_t timeout = UINT64_MAX) const;
+
     protected:
         RHI();
         ~RHI() noexcept;
@@ -52,6 +113,8 @@ namespace Nano
 
         bool isDeviceExtensionSupported(const char* extension_name) const;
 
+        bool                     m_is_headless {false};
+        bool                     m_is_bindless {false};
         VkInstance               m_instance {VK_NULL_HANDLE};
         std::vector<const char*> m_additional_instance_exts;
         uint32_t                 m_prefered_layer_cnt {0};
@@ -74,8 +137,18 @@ namespace Nano
         std::vector<VkExtensionProperties> m_device_extensions;
         uint32_t                           m_graphic_queue_family_index {0};
         uint32_t                           m_present_queue_family_index {0};
+        uint32_t                           m_compute_queue_family_index {0};
+        uint32_t                           m_transfer_queue_family_index {0};
+        std::vector<uint32_t>              m_shared_queue_family_indices;
         VkQueue                            m_graphic_queue {VK_NULL_HANDLE};
         VkQueue                            m_present_queue {VK_NULL_HANDLE};
+        VkQueue                            m_compute_queue {VK_NULL_HANDLE};
+        VkQueue                            m_transfer_queue {VK_NULL_HANDLE};
+
+        PFN_vkCmdPipelineBarrier2KHR m_vkCmdPipelineBarrier2KHR {VK_NULL_HANDLE};
+
+        VkSemaphore m_timelines[QUEUE_TYPE_COUNT] {};
+        uint64_t    m_timeline_values[QUEUE_TYPE_COUNT] {};
     };
 
 } // namespace Nano
@@ -2,6 +2,8 @@
 #define SHADER_H
 
 #include <vulkan/vulkan_core.h>
+#include <cstddef>
+#include <cstdint>
 
 namespace Nano
 {
@@ -16,12 +18,14 @@ namespace Nano
         Shader(Shader&&) noexcept            = delete;
         Shader& operator=(Shader&&) noexcept = delete;
 
+        // Loads a module of its own, ShaderLibrary::load() shares modules between their users instead.
         bool loadFromFile(const char* path);
+        // code is SPIR-V, size in bytes.
+        bool create(const uint8_t* code, size_t size);
 
         VkShaderModule getModule() const { return m_module; }
 
     private:
-        bool readFile(const char* path, char*& data, size_t& size);
         void cleanup();
 
         VkShaderModule m_module {VK_NULL_HANDLE};
@@ -0,0 +1,75 @@
+#include "shader_library.h"
+#include <cstring>
+#include "misc/logger.h"
+#include "misc/mapped_file.h"
+#include "shader.h"
+
+namespace Nano
+{
+    ShaderLibrary::ShaderLibrary() {}
+
+    ShaderLibrary::~ShaderLibrary() noexcept {}
+
+    uint64_t ShaderLibrary::hashCode(const uint8_t* code, size_t size)
+    {
+        // 64 bit FNV-1a
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= code[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::shared_ptr<Shader> ShaderLibrary::load(const char* path)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto path_it = m_shaders_by_path.find(path);
+        if (path_it != m_shaders_by_path.end())
+        {
+            if (std::shared_ptr<Shader> shader = path_it->second.lock())
+            {
+                return shader;
+            }
+        }
+
+        MappedFile file;
+        if (!file.open(path))
+        {
+            ERROR("Failed to read shader file: %s", path);
+            return nullptr;
+        }
+
+        const uint8_t*          code        = file.getData();
+        size_t                  size        = file.getSize();
+        CachedCode&             cached_code = m_shaders_by_code[{size, hashCode(code, size)}];
+        std::shared_ptr<Shader> shader      = cached_code.shader.lock();
+
+        // a collision gets a module of its own and leaves the cached one alone
+        bool is_same_code = shader && std::memcmp(cached_code.code.data(), code, size) == 0;
+        if (!is_same_code)
+        {
+            std::shared_ptr<Shader> new_shader = std::make_shared<Shader>();
+            if (!new_shader->create(code, size))
+            {
+                ERROR("Failed to create shader module from file: %s", path);
+                return nullptr;
+            }
+
+            if (!shader)
+            {
+                cached_code.shader = new_shader;
+                cached_code.code.assign(code, code + size);
+            }
+            shader = new_shader;
+
+            DEBUG("Created shader module for %s (%zu bytes)", path, size);
+        }
+
+        m_shaders_by_path[path] = shader;
+        return shader;
+    }
+
+} // namespace Nano
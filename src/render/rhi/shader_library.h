@@ -0,0 +1,61 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Nano
+{
+    class Shader;
+
+    // Hands out shared Shaders, so every RenderPass and Material loading the same SPIR-V file uses one module. A
+    // path seen before is returned without touching the file again, new paths are mapped and share the module of
+    // any live file with the same content, found by size and hash and confirmed byte by byte. The library only keeps
+    // weak references, a module goes away with its last user and is created again on the next load.
+    //
+    // Files changed on disk while their module is alive keep the old module.
+    class ShaderLibrary final
+    {
+    public:
+        static ShaderLibrary& instance()
+        {
+            static ShaderLibrary s_shader_library;
+            return s_shader_library;
+        }
+
+        // nullptr when the file cannot be read or is no valid module.
+        std::shared_ptr<Shader> load(const char* path);
+
+    protected:
+        ShaderLibrary();
+        ~ShaderLibrary() noexcept;
+
+        ShaderLibrary(const ShaderLibrary&)            = delete;
+        ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+        ShaderLibrary(ShaderLibrary&&)                 = delete;
+        ShaderLibrary& operator=(ShaderLibrary&&)      = delete;
+
+    private:
+        struct CachedCode
+        {
+            std::weak_ptr<Shader> shader;
+            std::vector<uint8_t>  code; // compared on a hit, equal hashes do not mean equal code
+        };
+
+        static uint64_t hashCode(const uint8_t* code, size_t size);
+
+        std::mutex                                             m_mutex;
+        std::unordered_map<std::string, std::weak_ptr<Shader>> m_shaders_by_path;
+        std::map<std::pair<size_t, uint64_t>, CachedCode>      m_shaders_by_code; // by size and hash
+    };
+
+} // namespace Nano
+
+#endif // !SHADER_LIBRARY_H
@@ -1,9 +1,12 @@
 #include "texture.h"
 #include <cstring>
+#include "bindless_heap.h"
 #include "buffer.h"
 #include "command_buffer.h"
+#include "memory_allocator.h"
 #include "misc/logger.h"
 #include "rhi.h"
+#include "upload_context.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
@@ -18,6 +21,18 @@ namespace Nano
     {
         RHI& rhi = RHI::instance();
 
+        if (m_bindless_sampled_index != BindlessHeap::INVALID_INDEX)
+        {
+            BindlessHeap::instance().release(BindlessSlot::SampledImage, m_bindless_sampled_index);
+            m_bindless_sampled_index = BindlessHeap::INVALID_INDEX;
+        }
+
+        if (m_bindless_storage_index != BindlessHeap::INVALID_INDEX)
+        {
+            BindlessHeap::instance().release(BindlessSlot::StorageImage, m_bindless_storage_index);
+            m_bindless_storage_index = BindlessHeap::INVALID_INDEX;
+        }
+
         if (m_image_view != VK_NULL_HANDLE)
         {
             vkDestroyImageView(rhi.getDevice(), m_image_view, nullptr);
@@ -30,11 +45,12 @@ namespace Nano
             m_image = VK_NULL_HANDLE;
         }
 
-        if (m_memory != VK_NULL_HANDLE)
+        if (m_allocation.memory != VK_NULL_HANDLE)
         {
-            vkFreeMemory(rhi.getDevice(), m_memory, nullptr);
-            m_memory = VK_NULL_HANDLE;
+            MemoryAllocator::instance().free(m_allocation);
         }
+
+        m_state = {};
     }
 
     bool Texture::create(uint32_t              width,
@@ -42,12 +58,25 @@ namespace Nano
                          VkFormat              format,
                          VkImageUsageFlags     usage,
                          VkMemoryPropertyFlags memory_property_flags)
+    {
+        if (!createUnbound(width, height, format, usage))
+            return false;
+
+        // Allocate and bind memory
+        if (!allocateMemory(memory_property_flags))
+            return false;
+
+        return true;
+    }
+
+    bool Texture::createUnbound(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage)
     {
         RHI& rhi = RHI::instance();
 
         m_width  = width;
         m_height = height;
         m_format = format;
+        m_usage  = usage;
 
         // Determine image aspect flags based on format
         if (format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
@@ -86,39 +115,70 @@ namespace Nano
             return false;
         }
 
-        // Allocate and bind memory
-        if (!allocateMemory(memory_property_flags))
+        return true;
+    }
+
+    bool Texture::bindMemory(VkDeviceMemory memory, VkDeviceSize offset)
+    {
+        RHI& rhi = RHI::instance();
+
+        if (vkBindImageMemory(rhi.getDevice(), m_image, memory, offset) != VK_SUCCESS)
+        {
+            ERROR("Failed to bind texture memory.");
             return false;
+        }
 
         return true;
     }
 
+    VkMemoryRequirements Texture::getMemoryRequirements() const
+    {
+        VkMemoryRequirements mem_requirements = {};
+        vkGetImageMemoryRequirements(RHI::instance().getDevice(), m_image, &mem_requirements);
+        return mem_requirements;
+    }
+
     bool Texture::allocateMemory(VkMemoryPropertyFlags memory_property_flags)
     {
         RHI& rhi = RHI::instance();
 
-        VkMemoryRequirements mem_requirements;
-        vkGetImageMemoryRequirements(rhi.getDevice(), m_image, &mem_requirements);
+        VkMemoryDedicatedRequirements dedicated_requirements = {};
+        dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
 
-        uint32_t memory_type_index = 0;
-        if (!rhi.findMemoryType(mem_requirements.memoryTypeBits, memory_property_flags, memory_type_index))
-        {
-            ERROR("Failed to find suitable memory type for texture.");
-            return false;
-        }
+        VkMemoryRequirements2 mem_requirements2 = {};
+        mem_requirements2.sType                 = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        mem_requirements2.pNext                 = &dedicated_requirements;
 
-        VkMemoryAllocateInfo vkMemoryAllocInfo = {};
-        vkMemoryAllocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        vkMemoryAllocInfo.allocationSize       = mem_requirements.size;
-        vkMemoryAllocInfo.memoryTypeIndex      = memory_type_index;
+        VkImageMemoryRequirementsInfo2 requirements_info = {};
+        requirements_info.sType                          = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+        requirements_info.image                          = m_image;
+        vkGetImageMemoryRequirements2(rhi.getDevice(), &requirements_info, &mem_requirements2);
 
-        if (vkAllocateMemory(rhi.getDevice(), &vkMemoryAllocInfo, nullptr, &m_memory) != VK_SUCCESS)
+        // render targets are big and live long, drivers can place them better in memory of their own
+        const VkImageUsageFlags render_target_usage =
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        bool is_dedicated = dedicated_requirements.prefersDedicatedAllocation ||
+                            dedicated_requirements.requiresDedicatedAllocation || (m_usage & render_target_usage) != 0;
+
+        MemoryAllocator& allocator    = MemoryAllocator::instance();
+        bool             is_allocated = false;
+        if (is_dedicated)
+        {
+            is_allocated = allocator.allocateDedicated(
+                mem_requirements2.memoryRequirements, memory_property_flags, m_allocation, m_image);
+        }
+        else
+        {
+            is_allocated = allocator.allocate(
+                mem_requirements2.memoryRequirements, memory_property_flags, MemoryResourceKind::Optimal, m_allocation);
+        }
+        if (!is_allocated)
         {
             ERROR("Failed to allocate texture memory.");
             return false;
         }
 
-        if (vkBindImageMemory(rhi.getDevice(), m_image, m_memory, 0) != VK_SUCCESS)
+        if (vkBindImageMemory(rhi.getDevice(), m_image, m_allocation.memory, m_allocation.offset) != VK_SUCCESS)
         {
             ERROR("Failed to bind texture memory.");
             return false;
@@ -153,6 +213,16 @@ namespace Nano
             return false;
         }
 
+        BindlessHeap& bindless_heap = BindlessHeap::instance();
+        if (m_usage & VK_IMAGE_USAGE_SAMPLED_BIT)
+        {
+            m_bindless_sampled_index = bindless_heap.registerSampledImage(m_image_view);
+        }
+        if (m_usage & VK_IMAGE_USAGE_STORAGE_BIT)
+        {
+            m_bindless_storage_index = bindless_heap.registerStorageImage(m_image_view);
+        }
+
         return true;
     }
 
@@ -174,7 +244,96 @@ namespace Nano
             return false;
         }
 
-        return uploadDataToImage(data, data_size, width, height);
+        return UploadContext::instance().uploadTexture(this, data, data_size);
+    }
+
+    bool Texture::readbackData(void* data, size_t data_size)
+    {
+        RHI& rhi = RHI::instance();
+
+        if (m_image == VK_NULL_HANDLE)
+        {
+            ERROR("Texture image not created. Call create() first.");
+            return false;
+        }
+
+        Buffer staging_buffer;
+        if (!staging_buffer.create(VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                   data_size,
+                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+        {
+            ERROR("Failed to create staging buffer for texture readback.");
+            return false;
+        }
+
+        CommandBuffer cmd;
+        if (!cmd.create())
+        {
+            ERROR("Failed to create command buffer for texture readback.");
+            return false;
+        }
+
+        if (!cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT))
+        {
+            ERROR("Failed to begin command buffer.");
+            return false;
+        }
+
+        BarrierBatch barriers;
+        barriers.access(this,
+                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                        VK_PIPELINE_STAGE_2_COPY_BIT_KHR,
+                        VK_ACCESS_2_TRANSFER_READ_BIT_KHR);
+        barriers.access(&staging_buffer, VK_PIPELINE_STAGE_2_COPY_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR);
+        barriers.flush(cmd.getCommandBuffer());
+
+        VkBufferImageCopy region               = {};
+        region.imageSubresource.aspectMask     = m_image_aspect_flags;
+        region.imageSubresource.mipLevel       = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount     = 1;
+        region.imageExtent                     = {m_width, m_height, 1};
+
+        vkCmdCopyImageToBuffer(cmd.getCommandBuffer(),
+                               m_image,
+                               VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               staging_buffer.getBuffer(),
+                               1,
+                               &region);
+
+        // makes the copy visible to the map below
+        barriers.access(&staging_buffer, VK_PIPELINE_STAGE_2_HOST_BIT_KHR, VK_ACCESS_2_HOST_READ_BIT_KHR);
+        barriers.flush(cmd.getCommandBuffer());
+
+        if (!cmd.end())
+        {
+            ERROR("Failed to end command buffer.");
+            return false;
+        }
+
+        uint64_t signal_value = 0;
+        if (!cmd.submitTimeline(signal_value))
+        {
+            ERROR("Failed to submit command buffer.");
+            return false;
+        }
+
+        if (!rhi.waitTimelineValue(rhi.getGraphicsTimeline(), signal_value))
+        {
+            ERROR("Failed to wait for texture readback to complete.");
+            return false;
+        }
+
+        void* mapped = staging_buffer.map();
+        if (mapped == nullptr)
+        {
+            ERROR("Failed to map staging buffer for texture readback.");
+            return false;
+        }
+        std::memcpy(data, mapped, data_size);
+        staging_buffer.unmap();
+
+        return true;
     }
 
     bool Texture::createFromFile(const char* path)
@@ -204,7 +363,7 @@ namespace Nano
         }
 
         size_t image_size = static_cast<size_t>(m_width) * m_height * 4; // RGBA
-        if (!uploadDataToImage(pixels, image_size, m_width, m_height))
+        if (!UploadContext::instance().uploadTexture(this, pixels, image_size))
         {
             stbi_image_free(pixels);
             return false;
@@ -250,149 +409,4 @@ namespace Nano
         return sampler;
     }
 
-    bool Texture::transitionImageLayout(VkCommandBuffer      command_buffer,
-                                        VkImageLayout        old_layout,
-                                        VkImageLayout        new_layout,
-                                        VkAccessFlags        src_access_mask,
-                                        VkAccessFlags        dst_access_mask,
-                                        VkPipelineStageFlags src_stage,
-                                        VkPipelineStageFlags dst_stage)
-    {
-        VkImageMemoryBarrier barrier            = {};
-        barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout                       = old_layout;
-        barrier.newLayout                       = new_layout;
-        barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image                           = m_image;
-        barrier.srcAccessMask                   = src_access_mask;
-        barrier.dstAccessMask                   = dst_access_mask;
-        barrier.subresourceRange.aspectMask     = m_image_aspect_flags;
-        barrier.subresourceRange.baseMipLevel   = 0;
-        barrier.subresourceRange.levelCount     = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount     = 1;
-
-        vkCmdPipelineBarrier(command_buffer, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-        return true;
-    }
-
-    bool Texture::copyBufferToImage(VkCommandBuffer command_buffer, VkBuffer buffer, uint32_t width, uint32_t height)
-    {
-        VkBufferImageCopy region               = {};
-        region.bufferOffset                    = 0;
-        region.bufferRowLength                 = 0;
-        region.bufferImageHeight               = 0;
-        region.imageSubresource.aspectMask     = m_image_aspect_flags;
-        region.imageSubresource.mipLevel       = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount     = 1;
-        region.imageOffset                     = {0, 0, 0};
-        region.imageExtent                     = {width, height, 1};
-
-        vkCmdCopyBufferToImage(command_buffer, buffer, m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-        return true;
-    }
-
-    bool Texture::uploadDataToImage(const void* data, size_t data_size, uint32_t width, uint32_t height)
-    {
-        RHI& rhi = RHI::instance();
-
-        Buffer staging_buffer;
-        if (!staging_buffer.create(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                   data_size,
-                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
-        {
-            ERROR("Failed to create staging buffer for texture upload.");
-            return false;
-        }
-
-        if (!staging_buffer.uploadData(data, data_size))
-        {
-            ERROR("Failed to upload data to staging buffer.");
-            return false;
-        }
-
-        CommandBuffer cmd;
-        if (!cmd.create())
-        {
-            ERROR("Failed to create command buffer for texture upload.");
-            return false;
-        }
-
-        if (!cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT))
-        {
-            ERROR("Failed to begin command buffer.");
-            return false;
-        }
-
-        transitionImageLayout(cmd.getCommandBuffer(),
-                              VK_IMAGE_LAYOUT_UNDEFINED,
-                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                              0,
-                              VK_ACCESS_TRANSFER_WRITE_BIT,
-                              VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                              VK_PIPELINE_STAGE_TRANSFER_BIT);
-
-        copyBufferToImage(cmd.getCommandBuffer(), staging_buffer.getBuffer(), width, height);
-
-        VkImageLayout        final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        VkAccessFlags        final_access = VK_ACCESS_SHADER_READ_BIT;
-        VkPipelineStageFlags final_stage  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-
-        if (m_image_aspect_flags & VK_IMAGE_ASPECT_DEPTH_BIT)
-        {
-            final_layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-            final_access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-            final_stage  = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        }
-
-        transitionImageLayout(cmd.getCommandBuffer(),
-                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                              final_layout,
-                              VK_ACCESS_TRANSFER_WRITE_BIT,
-                              final_access,
-                              VK_PIPELINE_STAGE_TRANSFER_BIT,
-                              final_stage);
-
-        if (!cmd.end())
-        {
-            ERROR("Failed to end command buffer.");
-            return false;
-        }
-
-        VkFence           fence;
-        VkFenceCreateInfo fence_info = {};
-        fence_info.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fence_info.flags             = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        if (vkCreateFence(rhi.getDevice(), &fence_info, nullptr, &fence) != VK_SUCCESS)
-        {
-            ERROR("Failed to create fence for texture upload.");
-            return false;
-        }
-
-        vkResetFences(rhi.getDevice(), 1, &fence);
-
-        if (!cmd.submit(
-                rhi.getGraphicsQueue(), VK_NULL_HANDLE, VK_NULL_HANDLE, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, fence))
-        {
-            vkDestroyFence(rhi.getDevice(), fence, nullptr);
-            ERROR("Failed to submit command buffer.");
-            return false;
-        }
-
-        if (vkWaitForFences(rhi.getDevice(), 1, &fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS)
-        {
-            vkDestroyFence(rhi.getDevice(), fence, nullptr);
-            ERROR("Failed to wait for texture upload to complete.");
-            return false;
-        }
-
-        vkDestroyFence(rhi.getDevice(), fence, nullptr);
-        return true;
-    }
-
 } // namespace Nano
@@ -3,6 +3,9 @@
 
 #include <vulkan/vulkan_core.h>
 #include <cstdint>
+#include "bindless_heap.h"
+#include "memory_allocator.h"
+#include "resource_state.h"
 
 namespace Nano
 {
@@ -24,15 +27,32 @@ namespace Nano
                     VkFormat              format,
                     VkImageUsageFlags     usage,
                     VkMemoryPropertyFlags memory_property_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        // Creates the image without memory, bindMemory() attaches memory owned by someone else, e.g. a RenderGraph
+        // aliasing it with other transient resources. The image view can only be created once memory is bound.
+        bool createUnbound(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage);
+        bool bindMemory(VkDeviceMemory memory, VkDeviceSize offset);
         bool createFromFile(const char* path);
         bool createImageView(VkImageAspectFlags aspect_flags = VK_IMAGE_ASPECT_NONE);
+        // Queued on the UploadContext, the image is ready for sampling once its next flush lands.
         bool uploadData(const void* data, size_t data_size, uint32_t width, uint32_t height);
+        // Copies the whole image into data and waits for it, the image needs VK_IMAGE_USAGE_TRANSFER_SRC_BIT. Meant
+        // for dumping results, not for per frame use.
+        bool readbackData(void* data, size_t data_size);
 
         VkImageView getImageView() const { return m_image_view; }
         VkImage     getImage() const { return m_image; }
         VkFormat    getFormat() const { return m_format; }
         uint32_t    getWidth() const { return m_width; }
         uint32_t    getHeight() const { return m_height; }
+        // Indices into the bindless heap, registered with the image view for sampled and storage usage.
+        // BindlessHeap::INVALID_INDEX without the usage or the heap.
+        uint32_t getBindlessSampledIndex() const { return m_bindless_sampled_index; }
+        uint32_t getBindlessStorageIndex() const { return m_bindless_storage_index; }
+
+        VkImageAspectFlags   getAspectFlags() const { return m_image_aspect_flags; }
+        VkMemoryRequirements getMemoryRequirements() const;
+        // Last GPU access and layout, kept up to date by BarrierBatch.
+        ResourceState& getState() { return m_state; }
 
         VkSampler createSampler(VkFilter             min_filter     = VK_FILTER_LINEAR,
                                 VkFilter             mag_filter     = VK_FILTER_LINEAR,
@@ -41,26 +61,21 @@ namespace Nano
                                 VkSamplerAddressMode address_mode_w = VK_SAMPLER_ADDRESS_MODE_REPEAT);
 
     private:
-        bool transitionImageLayout(VkCommandBuffer      command_buffer,
-                                   VkImageLayout        old_layout,
-                                   VkImageLayout        new_layout,
-                                   VkAccessFlags        src_access_mask,
-                                   VkAccessFlags        dst_access_mask,
-                                   VkPipelineStageFlags src_stage,
-                                   VkPipelineStageFlags dst_stage);
-        bool copyBufferToImage(VkCommandBuffer command_buffer, VkBuffer buffer, uint32_t width, uint32_t height);
-        bool uploadDataToImage(const void* data, size_t data_size, uint32_t width, uint32_t height);
         bool allocateMemory(VkMemoryPropertyFlags memory_property_flags);
         void cleanup();
 
         VkImage            m_image {VK_NULL_HANDLE};
-        VkDeviceMemory     m_memory {VK_NULL_HANDLE};
+        MemoryAllocation   m_allocation; // empty when bindMemory() attached someone else's memory
         VkImageView        m_image_view {VK_NULL_HANDLE};
         VkFormat           m_format {VK_FORMAT_UNDEFINED};
         VkImageAspectFlags m_image_aspect_flags {VK_IMAGE_ASPECT_NONE};
+        VkImageUsageFlags  m_usage {0};
         uint32_t           m_width {0};
         uint32_t           m_height {0};
         uint32_t           m_channel_count {0};
+        uint32_t           m_bindless_sampled_index {BindlessHeap::INVALID_INDEX};
+        uint32_t           m_bindless_storage_index {BindlessHeap::INVALID_INDEX};
+        ResourceState      m_state;
     };
 
 } // namespace Nano
@@ -0,0 +1,403 @@
+#include "upload_context.h"
+#include <algorithm>
+#include <cstring>
+#include "buffer.h"
+#include "memory_allocator.h"
+#include "misc/logger.h"
+#include "resource_state.h"
+#include "rhi.h"
+#include "texture.h"
+
+namespace Nano
+{
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // the ring and the command buffers go back through these singletons, so make sure they outlive this one
+    UploadContext::UploadContext()
+    {
+        RHI::instance();
+        MemoryAllocator::instance();
+        CommandAllocator::instance();
+    }
+
+    UploadContext::~UploadContext() noexcept
+    {
+        RHI& rhi = RHI::instance();
+        if (rhi.getDevice() == VK_NULL_HANDLE)
+            return;
+
+        if (m_recording.cmd != nullptr)
+        {
+            WARN("Dropping uploads that were never flushed.");
+        }
+        m_recording = Batch();
+
+        for (const Batch& batch : m_in_flight)
+        {
+            rhi.waitTimelineValue(rhi.getGraphicsTimeline(), batch.value);
+        }
+        m_in_flight.clear();
+
+        if (m_ring != nullptr)
+        {
+            m_ring.reset();
+            DEBUG("  Destroyed upload ring");
+        }
+    }
+
+    bool UploadContext::createRing()
+    {
+        m_ring = std::make_unique<Buffer>();
+        if (!m_ring->create(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                            RING_SIZE,
+                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+        {
+            ERROR("Failed to create upload ring.");
+            m_ring.reset();
+            return false;
+        }
+
+        // stays mapped for the ring's whole lifetime
+        m_ring_data = static_cast<uint8_t*>(m_ring->map());
+        if (m_ring_data == nullptr)
+        {
+            ERROR("Failed to map upload ring.");
+            m_ring.reset();
+            return false;
+        }
+
+        return true;
+    }
+
+    bool UploadContext::tryAllocateLocked(VkDeviceSize size, VkDeviceSize& out_offset)
+    {
+        if (m_used == 0)
+        {
+            m_head = 0;
+            m_tail = 0;
+        }
+
+        // the free space is [head, tail) once the head wrapped around, [head, end) and [0, tail) otherwise
+        VkDeviceSize offset          = alignUp(m_head, RING_ALIGNMENT);
+        bool         is_head_wrapped = m_head < m_tail || (m_head == m_tail && m_used != 0);
+        if (is_head_wrapped)
+        {
+            if (offset + size > m_tail)
+            {
+                return false;
+            }
+        }
+        else if (offset + size > RING_SIZE)
+        {
+            // the end of the ring stays padding until the batch retires
+            if (size > m_tail)
+            {
+                return false;
+            }
+            offset = 0;
+        }
+
+        VkDeviceSize head     = offset + size;
+        VkDeviceSize consumed = offset >= m_head ? head - m_head : RING_SIZE - m_head + head;
+
+        m_head                  = head;
+        m_used                 += consumed;
+        m_recording.ring_end    = head;
+        m_recording.ring_bytes += consumed;
+
+        out_offset = offset;
+        return true;
+    }
+
+    bool UploadContext::allocateLocked(VkDeviceSize size, VkDeviceSize& out_offset)
+    {
+        RHI& rhi = RHI::instance();
+
+        if (m_ring == nullptr && !createRing())
+        {
+            return false;
+        }
+
+        if (size > RING_SIZE)
+        {
+            ERROR("Upload of %llu bytes does not fit into the upload ring.", static_cast<unsigned long long>(size));
+            return false;
+        }
+
+        retireLocked();
+        while (!tryAllocateLocked(size, out_offset))
+        {
+            // the recording batch holds ring space too, it only comes back once the batch is submitted and done
+            if (!flushLocked())
+            {
+                return false;
+            }
+
+            if (m_in_flight.empty())
+            {
+                ERROR("Upload ring is full without any upload in flight.");
+                return false;
+            }
+
+            if (!rhi.waitTimelineValue(rhi.getGraphicsTimeline(), m_in_flight.front().value))
+            {
+                ERROR("Failed to wait for uploads to complete.");
+                return false;
+            }
+            retireLocked();
+        }
+
+        return true;
+    }
+
+    CommandBuffer* UploadContext::getCommandBufferLocked()
+    {
+        if (m_recording.cmd == nullptr)
+        {
+            // batches stay pending across frames, so they can't come from a frame slot's pools
+            auto cmd = std::make_unique<CommandBuffer>();
+            if (!cmd->create(VK_COMMAND_BUFFER_LEVEL_PRIMARY, CommandAllocator::PERSISTENT_SLOT, QueueType::Graphics) ||
+                !cmd->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT))
+            {
+                ERROR("Failed to begin upload command buffer.");
+                return nullptr;
+            }
+            m_recording.cmd = std::move(cmd);
+        }
+
+        return m_recording.cmd.get();
+    }
+
+    void UploadContext::retireLocked()
+    {
+        RHI& rhi = RHI::instance();
+
+        while (!m_in_flight.empty() && rhi.isTimelineValueReached(rhi.getGraphicsTimeline(), m_in_flight.front().value))
+        {
+            const Batch& batch = m_in_flight.front();
+            m_tail             = batch.ring_end;
+            m_used            -= batch.ring_bytes;
+            m_in_flight.pop_front();
+        }
+    }
+
+    bool UploadContext::flushLocked()
+    {
+        if (m_recording.ring_bytes == 0)
+        {
+            return true;
+        }
+
+        // the value is signaled even if the submission failed, so the batch retires either way. A batch that could
+        // not be recorded retires with the one before it.
+        uint64_t signal_value = m_last_value;
+        bool     is_submitted = false;
+        if (m_recording.cmd != nullptr && m_recording.cmd->end())
+        {
+            is_submitted = m_recording.cmd->submitTimeline(signal_value);
+        }
+
+        m_recording.value = signal_value;
+        m_last_value      = signal_value;
+        m_in_flight.push_back(std::move(m_recording));
+        m_recording = Batch();
+
+        if (!is_submitted)
+        {
+            ERROR("Failed to submit uploads.");
+            return false;
+        }
+
+        return true;
+    }
+
+    bool UploadContext::uploadBuffer(Buffer* buffer, const void* data, VkDeviceSize size, VkDeviceSize offset)
+    {
+        if (buffer == nullptr || data == nullptr || size == 0)
+        {
+            ERROR("Invalid buffer upload.");
+            return false;
+        }
+
+        if (offset + size > buffer->getSize())
+        {
+            ERROR("Upload of %llu bytes at offset %llu exceeds buffer size (%zu).",
+                  static_cast<unsigned long long>(size),
+                  static_cast<unsigned long long>(offset),
+                  buffer->getSize());
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (VkDeviceSize copied = 0; copied < size;)
+        {
+            VkDeviceSize chunk_size  = std::min(size - copied, MAX_CHUNK_SIZE);
+            VkDeviceSize ring_offset = 0;
+            if (!allocateLocked(chunk_size, ring_offset))
+            {
+                return false;
+            }
+
+            CommandBuffer* cmd = getCommandBufferLocked();
+            if (cmd == nullptr)
+            {
+                return false;
+            }
+
+            std::memcpy(m_ring_data + ring_offset, bytes + copied, chunk_size);
+
+            // chunks write disjoint ranges, only the first one has to wait for earlier uses of the buffer
+            if (copied == 0)
+            {
+                BarrierBatch barriers;
+                barriers.access(buffer, VK_PIPELINE_STAGE_2_COPY_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR);
+                barriers.flush(cmd->getCommandBuffer());
+            }
+
+            VkBufferCopy region = {};
+            region.srcOffset    = ring_offset;
+            region.dstOffset    = offset + copied;
+            region.size         = chunk_size;
+            vkCmdCopyBuffer(cmd->getCommandBuffer(), m_ring->getBuffer(), buffer->getBuffer(), 1, &region);
+
+            copied += chunk_size;
+        }
+
+        return true;
+    }
+
+    bool UploadContext::uploadTexture(Texture* texture, const void* data, size_t data_size)
+    {
+        if (texture == nullptr || data == nullptr || texture->getImage() == VK_NULL_HANDLE)
+        {
+            ERROR("Invalid texture upload.");
+            return false;
+        }
+
+        uint32_t width  = texture->getWidth();
+        uint32_t height = texture->getHeight();
+        if (data_size == 0 || data_size % height != 0)
+        {
+            ERROR("Texture upload size (%zu) does not match %u rows.", data_size, height);
+            return false;
+        }
+
+        // big images go in bands of rows
+        VkDeviceSize row_size = data_size / height;
+        if (row_size > MAX_CHUNK_SIZE)
+        {
+            ERROR("Texture rows of %llu bytes do not fit into the upload ring.",
+                  static_cast<unsigned long long>(row_size));
+            return false;
+        }
+        uint32_t rows_per_chunk = static_cast<uint32_t>(MAX_CHUNK_SIZE / row_size);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        BarrierBatch   barriers;
+        for (uint32_t row = 0; row < height;)
+        {
+            uint32_t     row_count   = std::min(rows_per_chunk, height - row);
+            VkDeviceSize ring_offset = 0;
+            if (!allocateLocked(row_size * row_count, ring_offset))
+            {
+                return false;
+            }
+
+            CommandBuffer* cmd = getCommandBufferLocked();
+            if (cmd == nullptr)
+            {
+                return false;
+            }
+
+            std::memcpy(m_ring_data + ring_offset, bytes + row * row_size, row_size * row_count);
+
+            if (row == 0)
+            {
+                barriers.access(texture,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                VK_PIPELINE_STAGE_2_COPY_BIT_KHR,
+                                VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR);
+                barriers.flush(cmd->getCommandBuffer());
+            }
+
+            VkBufferImageCopy region               = {};
+            region.bufferOffset                    = ring_offset;
+            region.imageSubresource.aspectMask     = texture->getAspectFlags();
+            region.imageSubresource.mipLevel       = 0;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount     = 1;
+            region.imageOffset                     = {0, static_cast<int32_t>(row), 0};
+            region.imageExtent                     = {width, row_count, 1};
+            vkCmdCopyBufferToImage(cmd->getCommandBuffer(),
+                                   m_ring->getBuffer(),
+                                   texture->getImage(),
+                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   1,
+                                   &region);
+
+            row += row_count;
+        }
+
+        if (texture->getAspectFlags() & VK_IMAGE_ASPECT_DEPTH_BIT)
+        {
+            barriers.access(texture,
+                            VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                            VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR,
+                            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR);
+        }
+        else
+        {
+            barriers.access(texture,
+                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                            VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR,
+                            VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR);
+        }
+        barriers.flush(m_recording.cmd->getCommandBuffer());
+
+        return true;
+    }
+
+    bool UploadContext::flush()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return flushLocked();
+    }
+
+    bool UploadContext::waitIdle()
+    {
+        RHI& rhi = RHI::instance();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!flushLocked())
+        {
+            return false;
+        }
+
+        if (!rhi.waitTimelineValue(rhi.getGraphicsTimeline(), m_last_value))
+        {
+            ERROR("Failed to wait for uploads to complete.");
+            return false;
+        }
+        retireLocked();
+
+        return true;
+    }
+
+    uint64_t UploadContext::getPendingValue() const
+    {
+        RHI& rhi = RHI::instance();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        return rhi.isTimelineValueReached(rhi.getGraphicsTimeline(), m_last_value) ? 0 : m_last_value;
+    }
+
+} // namespace Nano
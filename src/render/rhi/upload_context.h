@@ -0,0 +1,89 @@
+#ifndef UPLOAD_CONTEXT_H
+#define UPLOAD_CONTEXT_H
+
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include "command_buffer.h"
+
+namespace Nano
+{
+    class Buffer;
+    class Texture;
+
+    // Uploads into device local buffers and images through one persistently mapped staging ring. The data is copied
+    // into the ring right away and the copies are recorded into a batch, flush() submits the whole batch to the
+    // graphics queue at once. A batch's ring space is reused once the graphics timeline reaches its value, the CPU
+    // only waits when the ring runs full.
+    class UploadContext final
+    {
+    public:
+        static UploadContext& instance()
+        {
+            static UploadContext s_upload_context;
+            return s_upload_context;
+        }
+
+        static constexpr VkDeviceSize RING_SIZE {32ull * 1024 * 1024};
+        // bigger uploads are split, so a full ring only waits for part of them
+        static constexpr VkDeviceSize MAX_CHUNK_SIZE {RING_SIZE / 4};
+
+        // The buffer needs VK_BUFFER_USAGE_TRANSFER_DST_BIT, data can be freed as soon as this returns.
+        bool uploadBuffer(Buffer* buffer, const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+        // Fills the whole image and leaves it ready for sampling, it needs VK_IMAGE_USAGE_TRANSFER_DST_BIT.
+        bool uploadTexture(Texture* texture, const void* data, size_t data_size);
+
+        // Submits the copies recorded since the last flush.
+        bool flush();
+        // Flushes and blocks until every upload so far has landed.
+        bool waitIdle();
+
+        // Graphics timeline value of the last flushed batch if it is still running, 0 => all uploads landed. Other
+        // queues have to wait for it before touching uploaded resources.
+        uint64_t getPendingValue() const;
+
+    protected:
+        UploadContext();
+        ~UploadContext() noexcept;
+
+        UploadContext(const UploadContext&)            = delete;
+        UploadContext& operator=(const UploadContext&) = delete;
+        UploadContext(UploadContext&&)                 = delete;
+        UploadContext& operator=(UploadContext&&)      = delete;
+
+    private:
+        static constexpr VkDeviceSize RING_ALIGNMENT {16}; // covers the texel size of every format we upload
+
+        struct Batch
+        {
+            std::unique_ptr<CommandBuffer> cmd;
+            VkDeviceSize                   ring_end {0};   // ring head after the batch's last allocation
+            VkDeviceSize                   ring_bytes {0}; // including the padding of wrapping around
+            uint64_t                       value {0};
+        };
+
+        bool createRing();
+        // Makes room in the ring, flushing the recording batch and waiting for old ones when it is full.
+        bool allocateLocked(VkDeviceSize size, VkDeviceSize& out_offset);
+        bool tryAllocateLocked(VkDeviceSize size, VkDeviceSize& out_offset);
+        // Returns the recording command buffer, begun on first use.
+        CommandBuffer* getCommandBufferLocked();
+        bool           flushLocked();
+        void           retireLocked();
+
+        mutable std::mutex      m_mutex;
+        std::unique_ptr<Buffer> m_ring;
+        uint8_t*                m_ring_data {nullptr};
+        VkDeviceSize            m_head {0}; // next free byte
+        VkDeviceSize            m_tail {0}; // first byte still read by a batch
+        VkDeviceSize            m_used {0};
+        Batch                   m_recording;
+        std::deque<Batch>       m_in_flight;
+        uint64_t                m_last_value {0};
+    };
+
+} // namespace Nano
+
+#endif // !UPLOAD_CONTEXT_H
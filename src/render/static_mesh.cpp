@@ -71,9 +71,9 @@ namespace Nano
 
         m_vertex_buffer           = std::make_unique<Buffer>();
         size_t vertex_buffer_size = sizeof(Vertex) * vertex_count;
-        if (!m_vertex_buffer->create(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        if (!m_vertex_buffer->create(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                                      vertex_buffer_size,
-                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
         {
             ERROR("Failed to create vertex buffer for StaticMesh.");
             return false;
@@ -89,9 +89,9 @@ namespace Nano
         {
             m_index_buffer           = std::make_unique<Buffer>();
             size_t index_buffer_size = sizeof(uint32_t) * index_count;
-            if (!m_index_buffer->create(VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            if (!m_index_buffer->create(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                                         index_buffer_size,
-                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
             {
                 ERROR("Failed to create index buffer for StaticMesh.");
                 return false;
@@ -142,9 +142,9 @@ namespace Nano
 
         m_vertex_buffer           = std::make_unique<Buffer>();
         size_t vertex_buffer_size = sizeof(Vertex) * vertex_count;
-        if (!m_vertex_buffer->create(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        if (!m_vertex_buffer->create(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                                      vertex_buffer_size,
-                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
         {
             ERROR("Failed to create vertex buffer for StaticMesh.");
             std::fclose(file);
@@ -230,9 +230,9 @@ namespace Nano
         {
             m_index_buffer           = std::make_unique<Buffer>();
             size_t index_buffer_size = sizeof(uint32_t) * m_index_count;
-            if (!m_index_buffer->create(VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            if (!m_index_buffer->create(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                                         index_buffer_size,
-                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
             {
                 ERROR("Failed to create index buffer for StaticMesh.");
                 return false;
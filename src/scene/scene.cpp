@@ -1,10 +1,725 @@
 #include "scene.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "misc/logger.h"
+#include "render/render_graph.h"
+#include "render/render_pass.h"
+#include "render/rhi/buffer.h"
+#include "render/rhi/command_buffer.h"
+#include "render/rhi/dynamic_buffer.h"
+#include "render/rhi/rhi.h"
+#include "render/rhi/texture.h"
+#include "render/rhi/upload_context.h"
 
 namespace Nano
 {
+    // bvh node => 4 child slices, 13 uints each (LODBounds, Misc0, Misc1 as uvec4 arrays, then Misc2)
+    static constexpr uint32_t HIERARCHY_NODE_FANOUT     = 4;
+    static constexpr uint32_t HIERARCHY_NODE_UINT_COUNT = (4 + 4 + 4 + 1) * HIERARCHY_NODE_FANOUT;
+    static constexpr uint32_t HIERARCHY_SLICE_INTERNAL  = 0xFFFFFFFFu; // Misc2 of a slice pointing to another node
+    static constexpr uint32_t WORK_ARGS_SIZE            = 8 * sizeof(uint32_t);
+    static constexpr uint32_t SW_RASTER_ARGS_OFFSET     = 1 * sizeof(uint32_t); // ClusterWorkArgs[1..3]
+    static constexpr uint32_t CLUSTER_CULL_ARGS_OFFSET  = 5 * sizeof(uint32_t); // ClusterWorkArgs[5..7]
+    static constexpr uint32_t CULLING_PASS_MAIN         = 0; // tests against last frame's HZB
+    static constexpr uint32_t CULLING_PASS_POST         = 1; // re-tests what the main pass found occluded
+    static constexpr uint32_t MISC0_PREV_HZB_VALID      = 1u;
+    static constexpr uint32_t HZB_GROUP_SIZE            = 16;
+
+    // push constants of Init.glsl, both permutations
+    struct InitPushConstants
+    {
+        glm::uvec2 view_size {0u};
+        uint32_t   level_count {0}; // entries of WorkArgs behind level 0 to clear
+    };
+
+    // push constants of NodeAndClusterCull.glsl
+    struct NodeCullPushConstants
+    {
+        uint32_t level {0};
+        uint32_t culling_pass {0};
+    };
+
+    static bool readBinaryFile(const char* path, std::vector<uint32_t>& data)
+    {
+        FILE* file = std::fopen(path, "rb");
+        if (file == nullptr)
+        {
+            ERROR("Failed to open file: %s", path);
+            return false;
+        }
+
+        std::fseek(file, 0, SEEK_END);
+        long file_size = std::ftell(file);
+        std::rewind(file);
+
+        if (file_size <= 0 || file_size % sizeof(uint32_t) != 0)
+        {
+            ERROR("File is empty or not dword aligned: %s", path);
+            std::fclose(file);
+            return false;
+        }
+
+        data.resize(static_cast<size_t>(file_size) / sizeof(uint32_t));
+        size_t read_size = std::fread(data.data(), 1, file_size, file);
+        std::fclose(file);
+
+        if (read_size != static_cast<size_t>(file_size))
+        {
+            ERROR("Failed to read file completely: %s (read %zu/%ld)", path, read_size, file_size);
+            return false;
+        }
+
+        return true;
+    }
+
+    // Number of NodeAndClusterCull levels needed to reach every leaf below node_index.
+    static uint32_t computeHierarchyDepth(const std::vector<uint32_t>& nodes, uint32_t node_index, uint32_t max_depth)
+    {
+        size_t base = static_cast<size_t>(node_index) * HIERARCHY_NODE_UINT_COUNT;
+        if (max_depth == 0 || base + HIERARCHY_NODE_UINT_COUNT > nodes.size())
+        {
+            return 0;
+        }
+
+        uint32_t child_depth = 0;
+        for (uint32_t child = 0; child < HIERARCHY_NODE_FANOUT; ++child)
+        {
+            if (nodes[base + 48 + child] != HIERARCHY_SLICE_INTERNAL)
+            {
+                continue;
+            }
+
+            uint32_t child_node_index = nodes[base + 32 + child * 4 + 3];
+            child_depth = std::max(child_depth, computeHierarchyDepth(nodes, child_node_index, max_depth - 1));
+        }
+
+        return child_depth + 1;
+    }
+
+    // Float count of the HZB mip chain, mip 0 is half the viewport and every mip halves the previous one.
+    static size_t computeHZBSize(uint32_t width, uint32_t height)
+    {
+        uint32_t mip_width  = (width + 1) / 2;
+        uint32_t mip_height = (height + 1) / 2;
+        size_t   size       = static_cast<size_t>(mip_width) * mip_height;
+        while (mip_width > 1 || mip_height > 1)
+        {
+            mip_width  = std::max((mip_width + 1) / 2, 1u);
+            mip_height = std::max((mip_height + 1) / 2, 1u);
+            size += static_cast<size_t>(mip_width) * mip_height;
+        }
+        return size;
+    }
+
     Scene::Scene() {}
 
-    Scene::~Scene() noexcept {}
+    Scene::~Scene() noexcept { cleanup(); }
+
+    void Scene::cleanup()
+    {
+        if (!m_constant_buffer)
+        {
+            return;
+        }
+
+        RHI& rhi = RHI::instance();
+        vkDeviceWaitIdle(rhi.getDevice());
+
+        for (auto& frame_context : m_frame_contexts)
+        {
+            frame_context.reset();
+        }
+        m_frame_index = 0;
+
+        m_visualize_pass.reset();
+        m_hzb_build_pass.reset();
+        m_hw_rasterize_pass.reset();
+        for (uint32_t culling_pass = 0; culling_pass < 2; ++culling_pass)
+        {
+            m_sw_rasterize_passes[culling_pass].reset();
+            m_cluster_cull_passes[culling_pass].reset();
+            m_node_and_cluster_cull_passes[culling_pass].reset();
+        }
+        m_init_vis_buffer_pass.reset();
+        m_init_pass.reset();
+
+        // owns the transient resources
+        m_render_graph.reset();
+        m_visualize_texture                      = nullptr;
+        m_vis_buffer64                           = nullptr;
+        m_visible_cluster_draw_args              = nullptr;
+        m_visible_clusters                       = nullptr;
+        m_post_cluster_work_args                 = nullptr;
+        m_post_work_args                         = nullptr;
+        m_cluster_work_args                      = nullptr;
+        m_work_args                              = nullptr;
+        m_main_and_post_node_and_cluster_batches = nullptr;
+
+        m_hzb_counter.reset();
+        m_hzb.reset();
+        m_echo_buffer.reset();
+        m_cluster_page_data_buffer.reset();
+        m_bvh_buffer.reset();
+        m_constant_buffer.reset();
+
+        m_is_initialized = false;
+        DEBUG("  Destroyed scene");
+    }
+
+    bool Scene::initialize(uint32_t width, uint32_t height)
+    {
+        m_width  = width;
+        m_height = height;
+
+        if (!loadHierarchy("res/mitsuba.bvh"))
+            return false;
+
+        if (!loadClusterPages("res/mitsuba.nanitemesh"))
+            return false;
+
+        // the work args hold an entry per hierarchy level
+        if (!createBuffers())
+            return false;
+
+        // the copies run while the passes and pipelines are built
+        if (!UploadContext::instance().flush())
+            return false;
+
+        if (!createPasses())
+            return false;
+
+        // descriptors can only be written once the render graph bound the transient resources
+        if (!createRenderGraph())
+            return false;
+
+        if (!buildPasses())
+            return false;
+
+        for (uint32_t frame_slot = 0; frame_slot < FrameContext::MAX_FRAMES_IN_FLIGHT; ++frame_slot)
+        {
+            m_frame_contexts[frame_slot] = std::make_unique<FrameContext>();
+            if (!m_frame_contexts[frame_slot]->create(frame_slot))
+                return false;
+        }
+
+        m_is_initialized = true;
+        return true;
+    }
+
+    bool Scene::createBuffers()
+    {
+        const VkBufferUsageFlags args_usage =
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+        // frames in flight each write their constants into a region of their own
+        m_constant_buffer = std::make_unique<DynamicBuffer>();
+        if (!m_constant_buffer->create(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, CONSTANT_BUFFER_FRAME_SIZE))
+        {
+            ERROR("Failed to create constant buffer.");
+            return false;
+        }
+
+        m_echo_buffer = std::make_unique<Buffer>();
+        if (!m_echo_buffer->create(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 1024 * sizeof(uint32_t)))
+        {
+            ERROR("Failed to create echo buffer.");
+            return false;
+        }
+
+        // last frame's HZB is read by the main pass, so it has to persist outside the render graph
+        m_hzb = std::make_unique<Buffer>();
+        if (!m_hzb->create(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, computeHZBSize(m_width, m_height) * sizeof(float)))
+        {
+            ERROR("Failed to create HZB buffer.");
+            return false;
+        }
+
+        m_hzb_counter = std::make_unique<Buffer>();
+        if (!m_hzb_counter->create(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                   sizeof(uint32_t)))
+        {
+            ERROR("Failed to create HZB counter buffer.");
+            return false;
+        }
+
+        // everything below is rebuilt every frame, the render graph binds the memory once all passes are declared
+        m_render_graph = std::make_unique<RenderGraph>();
+
+        // main and post node lists first, main and post candidate (page, cluster) pairs behind them
+        m_main_and_post_node_and_cluster_batches =
+            m_render_graph->createBuffer("MainAndPostNodeAndClusterBatches",
+                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                         (MAX_CANDIDATE_NODES + MAX_CANDIDATE_CLUSTERS * 2) * 2 * sizeof(uint32_t));
+
+        // level N reads entry N and appends to entry N + 1, so no level waits for a clear of the one before
+        size_t work_args_size = static_cast<size_t>(m_hierarchy_depth + 1) * WORK_ARGS_SIZE;
+        m_work_args           = m_render_graph->createBuffer("WorkArgs", args_usage, work_args_size);
+        m_post_work_args      = m_render_graph->createBuffer("PostWorkArgs", args_usage, work_args_size);
+
+        m_cluster_work_args      = m_render_graph->createBuffer("ClusterWorkArgs", args_usage, WORK_ARGS_SIZE);
+        m_post_cluster_work_args = m_render_graph->createBuffer("PostClusterWorkArgs", args_usage, WORK_ARGS_SIZE);
+
+        // HW raster clusters in the first half, SW raster clusters in the second one
+        m_visible_clusters = m_render_graph->createBuffer(
+            "VisibleClusters", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MAX_CANDIDATE_CLUSTERS * 2 * 4 * sizeof(uint32_t));
+
+        m_visible_cluster_draw_args =
+            m_render_graph->createBuffer("VisibleClusterDrawArgs",
+                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                         MAX_CANDIDATE_CLUSTERS * sizeof(VkDrawIndirectCommand));
+
+        m_vis_buffer64 = m_render_graph->createBuffer("VisBuffer64",
+                                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                      static_cast<size_t>(m_width) * m_height * sizeof(uint64_t));
+
+        m_visualize_texture = m_render_graph->createTexture("VisualizeTexture",
+                                                            m_width,
+                                                            m_height,
+                                                            VK_FORMAT_R32G32B32A32_SFLOAT,
+                                                            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                                                                VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+
+        if (m_main_and_post_node_and_cluster_batches == nullptr || m_work_args == nullptr ||
+            m_post_work_args == nullptr || m_cluster_work_args == nullptr || m_post_cluster_work_args == nullptr ||
+            m_visible_clusters == nullptr || m_visible_cluster_draw_args == nullptr || m_vis_buffer64 == nullptr ||
+            m_visualize_texture == nullptr)
+        {
+            ERROR("Failed to create transient frame resources.");
+            return false;
+        }
+
+        return true;
+    }
+
+    bool Scene::loadHierarchy(const char* path)
+    {
+        std::vector<uint32_t> nodes;
+        if (!readBinaryFile(path, nodes))
+            return false;
+
+        uint32_t node_count = static_cast<uint32_t>(nodes.size() / HIERARCHY_NODE_UINT_COUNT);
+        if (node_count == 0 || nodes.size() % HIERARCHY_NODE_UINT_COUNT != 0)
+        {
+            ERROR("Invalid hierarchy file: %s", path);
+            return false;
+        }
+
+        m_bvh_buffer = std::make_unique<Buffer>();
+        if (!m_bvh_buffer->create(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                  nodes.size() * sizeof(uint32_t)) ||
+            !m_bvh_buffer->uploadData(nodes.data(), nodes.size() * sizeof(uint32_t)))
+        {
+            ERROR("Failed to upload hierarchy: %s", path);
+            return false;
+        }
+
+        m_hierarchy_depth = computeHierarchyDepth(nodes, 0, node_count);
+        INFO("Loaded hierarchy %s: %u nodes, %u levels", path, node_count, m_hierarchy_depth);
+
+        // frame the root bounds with a default camera
+        glm::vec3 bounds_min(1e30f);
+        glm::vec3 bounds_max(-1e30f);
+        for (uint32_t child = 0; child < HIERARCHY_NODE_FANOUT; ++child)
+        {
+            if (nodes[48 + child] == 0u)
+                continue;
+
+            glm::vec3 center;
+            glm::vec3 extent;
+            std::memcpy(&center, &nodes[16 + child * 4], sizeof(center));
+            std::memcpy(&extent, &nodes[32 + child * 4], sizeof(extent));
+            bounds_min = glm::min(bounds_min, center - extent);
+            bounds_max = glm::max(bounds_max, center + extent);
+        }
+
+        glm::vec3 center     = (bounds_min + bounds_max) * 0.5f;
+        float     radius     = std::max(glm::length(bounds_max - bounds_min) * 0.5f, 0.01f);
+        float     near_plane = radius * 0.01f;
+        glm::mat4 projection = glm::perspectiveRH_ZO(
+            glm::radians(50.0f), float(m_width) / float(m_height), near_plane, radius * 100.0f);
+        projection[1][1] *= -1.0f; // vulkan clip space is y down
+
+        setView(glm::lookAt(center + glm::vec3(0.0f, 0.0f, radius * 2.0f), center, glm::vec3(0.0f, 1.0f, 0.0f)),
+                projection,
+                near_plane,
+                m_width,
+                m_height);
+        return true;
+    }
+
+    bool Scene::loadClusterPages(const char* path)
+    {
+        std::vector<uint32_t> pages;
+        if (!readBinaryFile(path, pages))
+            return false;
+
+        m_cluster_page_data_buffer = std::make_unique<Buffer>();
+        if (!m_cluster_page_data_buffer->create(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                pages.size() * sizeof(uint32_t)) ||
+            !m_cluster_page_data_buffer->uploadData(pages.data(), pages.size() * sizeof(uint32_t)))
+        {
+            ERROR("Failed to upload cluster pages: %s", path);
+            return false;
+        }
+
+        INFO("Loaded cluster pages %s: %u pages", path, pages[0]);
+        return true;
+    }
+
+    bool Scene::createPasses()
+    {
+        m_init_pass = std::make_unique<RenderPass>(RenderPassType::Compute, "Init");
+        m_init_pass->setComputeShader("shaders/Init.sb");
+        InitPushConstants init_push_constants;
+        init_push_constants.view_size   = glm::uvec2(m_width, m_height);
+        init_push_constants.level_count = m_hierarchy_depth;
+
+        m_init_pass->bindResource(0, m_work_args, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+        m_init_pass->bindResource(2, m_main_and_post_node_and_cluster_batches, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+        m_init_pass->bindResource(4, m_cluster_work_args, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+        m_init_pass->bindResource(5, m_post_work_args, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+        m_init_pass->bindResource(6, m_post_cluster_work_args, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+        m_init_pass->setPushConstants(init_push_constants);
+        m_init_pass->setComputeDispatchArgs(1, 1, 1);
+
+        m_init_vis_buffer_pass = std::make_unique<RenderPass>(RenderPassType::Compute, "InitVisBuffer");
+        m_init_vis_buffer_pass->setComputeShader("shaders/InitVisBuffer.sb");
+        m_init_vis_buffer_pass->bindResource(3, m_vis_buffer64, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+        m_init_vis_buffer_pass->setPushConstants(init_push_constants);
+        m_init_vis_buffer_pass->setComputeDispatchArgs((m_width + 7) / 8, (m_height + 7) / 8, 1);
+
+        for (uint32_t culling_pass = 0; culling_pass < 2; ++culling_pass)
+        {
+            bool    is_main           = culling_pass == CULLING_PASS_MAIN;
+            Buffer* work_args         = is_main ? m_work_args : m_post_work_args;
+            Buffer* cluster_work_args = is_main ? m_cluster_work_args : m_post_cluster_work_args;
+
+            // addCullingPasses() records it once per level, pushing the level and pointing the dispatch at its
+            // entry of the work args. Both culling passes dispatch the pipeline of the main one with their own
+            // resources, the culling pass is pushed as well.
+            auto&       pass = m_node_and_cluster_cull_passes[culling_pass];
+            const char* name = is_main ? "NodeAndClusterCull" : "NodeAndClusterCullPost";
+            pass             = std::make_unique<RenderPass>(RenderPassType::Compute, name);
+            if (is_main)
+                pass->setComputeShader("shaders/NodeAndClusterCull.sb");
+            else
+                pass->sharePipeline(*m_node_and_cluster_cull_passes[CULLING_PASS_MAIN]);
+            pass->bindResource(0, m_bvh_buffer.get());
+            pass->bindResource(1, m_echo_buffer.get());
+            pass->bindResource(2, m_main_and_post_node_and_cluster_batches, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+            pass->bindResource(3, work_args, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+            pass->setDynamicUniformBuffer(
+                5, m_constant_buffer.get(), sizeof(GlobalConstants), &m_global_constants_offset);
+            pass->bindResource(6, cluster_work_args, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+            pass->bindResource(7, m_hzb.get());
+            // only the main pass defers nodes to the post pass, the post pass binds it to match the layout
+            pass->bindResource(8, m_post_work_args, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+            pass->setPushConstants(NodeCullPushConstants {0, culling_pass});
+            pass->setComputeDispatchIndirect(work_args);
+
+            auto& cluster_cull_pass = m_cluster_cull_passes[culling_pass];
+            cluster_cull_pass =
+                std::make_unique<RenderPass>(RenderPassType::Compute, is_main ? "ClusterCull" : "ClusterCullPost");
+            cluster_cull_pass->setComputeShader(is_main ? "shaders/ClusterCull.sb" : "shaders/ClusterCullPost.sb");
+            cluster_cull_pass->setDynamicUniformBuffer(
+                0, m_constant_buffer.get(), sizeof(GlobalConstants), &m_global_constants_offset);
+            cluster_cull_pass->bindResource(1,
+                                            m_main_and_post_node_and_cluster_batches,
+                                            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                            true);
+            cluster_cull_pass->bindResource(2, m_visible_clusters, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+            cluster_cull_pass->bindResource(3, cluster_work_args, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+            cluster_cull_pass->bindResource(4, m_cluster_page_data_buffer.get());
+            cluster_cull_pass->bindResource(5, m_visible_cluster_draw_args, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+            cluster_cull_pass->bindResource(6, m_hzb.get());
+            if (is_main)
+                cluster_cull_pass->bindResource(7, m_post_cluster_work_args, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+            cluster_cull_pass->setComputeDispatchIndirect(cluster_work_args, CLUSTER_CULL_ARGS_OFFSET);
+
+            // one group per cluster ClusterCull sent to the compute rasterizer
+            auto& sw_rasterize_pass = m_sw_rasterize_passes[culling_pass];
+            sw_rasterize_pass =
+                std::make_unique<RenderPass>(RenderPassType::Compute, is_main ? "SWRasterize" : "SWRasterizePost");
+            sw_rasterize_pass->setComputeShader("shaders/SWRasterize.sb");
+            sw_rasterize_pass->setDynamicUniformBuffer(
+                0, m_constant_buffer.get(), sizeof(GlobalConstants), &m_global_constants_offset);
+            sw_rasterize_pass->bindResource(1, m_cluster_page_data_buffer.get());
+            sw_rasterize_pass->bindResource(2, m_visible_clusters);
+            sw_rasterize_pass->bindResource(3, m_vis_buffer64, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+            sw_rasterize_pass->bindResource(4, cluster_work_args);
+            sw_rasterize_pass->setComputeDispatchIndirect(cluster_work_args, SW_RASTER_ARGS_OFFSET);
+        }
+
+        m_hw_rasterize_pass = std::make_unique<RenderPass>(RenderPassType::Graphics, "HWRasterize");
+        m_hw_rasterize_pass->setGraphicsShaders("shaders/HWRasterizeVS.sb", "shaders/HWRasterizeFS.sb");
+        m_hw_rasterize_pass->setDynamicUniformBuffer(
+            0, m_constant_buffer.get(), sizeof(GlobalConstants), &m_global_constants_offset);
+        m_hw_rasterize_pass->bindResource(1, m_cluster_page_data_buffer.get());
+        m_hw_rasterize_pass->bindResource(2, m_visible_clusters);
+        m_hw_rasterize_pass->bindResource(3, m_vis_buffer64, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+        m_hw_rasterize_pass->setPushConstants(glm::uvec2(m_width, m_height));
+
+        // one thread per mip 0 texel, i.e. per 2x2 pixels
+        m_hzb_build_pass = std::make_unique<RenderPass>(RenderPassType::Compute, "HZBBuild");
+        m_hzb_build_pass->setComputeShader("shaders/HZBBuild.sb");
+        m_hzb_build_pass->setDynamicUniformBuffer(
+            0, m_constant_buffer.get(), sizeof(GlobalConstants), &m_global_constants_offset);
+        m_hzb_build_pass->bindResource(1, m_vis_buffer64);
+        m_hzb_build_pass->bindResource(2, m_hzb.get(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+        m_hzb_build_pass->bindResource(3, m_hzb_counter.get(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, true);
+        m_hzb_build_pass->setComputeDispatchArgs(((m_width + 1) / 2 + HZB_GROUP_SIZE - 1) / HZB_GROUP_SIZE,
+                                                 ((m_height + 1) / 2 + HZB_GROUP_SIZE - 1) / HZB_GROUP_SIZE,
+                                                 1);
+        m_hzb_build_pass->addClearBuffer(m_hzb_counter.get());
+
+        m_visualize_pass = std::make_unique<RenderPass>(RenderPassType::Compute, "Visualize");
+        m_visualize_pass->setComputeShader("shaders/Visualize.sb");
+        m_visualize_pass->bindResource(0, m_vis_buffer64);
+        m_visualize_pass->bindResource(1, m_visualize_texture, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, true);
+        m_visualize_pass->setPushConstants(glm::uvec2(m_width, m_height));
+        m_visualize_pass->setComputeDispatchArgs((m_width + 7) / 8, (m_height + 7) / 8, 1);
+
+        return true;
+    }
+
+    bool Scene::buildPasses()
+    {
+        if (!m_init_pass->build() || !m_init_vis_buffer_pass->build())
+            return false;
+
+        for (uint32_t culling_pass = 0; culling_pass < 2; ++culling_pass)
+        {
+            if (!m_node_and_cluster_cull_passes[culling_pass]->build() ||
+                !m_cluster_cull_passes[culling_pass]->build() || !m_sw_rasterize_passes[culling_pass]->build())
+                return false;
+        }
+
+        if (!m_hw_rasterize_pass->build(m_width, m_height))
+            return false;
+
+        if (!m_hzb_build_pass->build())
+            return false;
+
+        if (!m_visualize_pass->build())
+            return false;
+
+        return true;
+    }
+
+    void Scene::addCullingPasses(uint32_t culling_pass)
+    {
+        bool    is_main           = culling_pass == CULLING_PASS_MAIN;
+        Buffer* work_args         = is_main ? m_work_args : m_post_work_args;
+        Buffer* cluster_work_args = is_main ? m_cluster_work_args : m_post_cluster_work_args;
+
+        // the main pass only depends on the previous frame's HZB, so it culls on the async compute queue while the
+        // previous frame still visualizes. The post pass needs this frame's HZB and stays on graphics.
+        QueueType cull_queue = is_main ? QueueType::Compute : QueueType::Graphics;
+
+        // every level sizes itself from the entry of the work args the previous one wrote, levels past the
+        // deepest visible node simply dispatch zero groups. All levels share the pass, only the pushed level and
+        // the indirect offset change.
+        RenderPass* node_and_cluster_cull_pass = m_node_and_cluster_cull_passes[culling_pass].get();
+        for (uint32_t level = 0; level < m_hierarchy_depth; ++level)
+        {
+            std::string name = node_and_cluster_cull_pass->getName() + std::to_string(level);
+            m_render_graph
+                ->addPass(name.c_str(),
+                          [=](CommandBuffer& cmd) {
+                              node_and_cluster_cull_pass->setPushConstants(NodeCullPushConstants {level, culling_pass});
+                              node_and_cluster_cull_pass->setComputeDispatchIndirect(work_args, level * WORK_ARGS_SIZE);
+                              node_and_cluster_cull_pass->record(cmd);
+                          })
+                .use(*node_and_cluster_cull_pass)
+                .setQueue(cull_queue);
+        }
+
+        m_render_graph->addPass(m_cluster_cull_passes[culling_pass].get()).setQueue(cull_queue);
+
+        if (is_main)
+        {
+            m_render_graph->addPass(m_init_vis_buffer_pass.get());
+        }
+
+        // one draw per HW cluster, the count comes from ClusterWorkArgs[0]. Both culling passes share the raster
+        // pass, so the draw is configured again when it records.
+        RenderPass* hw_rasterize_pass = m_hw_rasterize_pass.get();
+        Buffer*     draw_args         = m_visible_cluster_draw_args;
+        auto        set_draw_indirect = [=]() {
+            hw_rasterize_pass->setDrawIndirect(
+                draw_args, 0, MAX_CANDIDATE_CLUSTERS, sizeof(VkDrawIndirectCommand), cluster_work_args, 0);
+        };
+        set_draw_indirect();
+        m_render_graph
+            ->addPass(is_main ? "HWRasterize" : "HWRasterizePost",
+                      [=](CommandBuffer& cmd) {
+                          set_draw_indirect();
+                          hw_rasterize_pass->record(cmd);
+                      })
+            .use(*hw_rasterize_pass);
+
+        // small triangle clusters, both paths resolve depth with the same 64 bit atomicMin
+        m_render_graph->addPass(m_sw_rasterize_passes[culling_pass].get());
+
+        m_render_graph->addPass(m_hzb_build_pass.get());
+    }
+
+    bool Scene::createRenderGraph()
+    {
+        // frames share the imported buffers, every pass records the barriers against the last access of what it
+        // binds, the previous frame's included. The constants are host written before the frame is submitted, they
+        // need no pass of their own.
+        m_render_graph->addPass(m_init_pass.get()).setQueue(QueueType::Compute);
+
+        // main pass: everything visible in last frame's HZB, the rest is queued for the post pass.
+        // It ends with the HZB of what it drew.
+        addCullingPasses(CULLING_PASS_MAIN);
+
+        // post pass: re-tests the occluded nodes and clusters against the HZB of the main pass, so disoccluded
+        // geometry shows up this frame. It reuses the visible cluster buffers the main raster is done with and
+        // leaves the full frame HZB for the next frame's main pass.
+        addCullingPasses(CULLING_PASS_POST);
+
+        // culled along with the visualize texture when nothing consumes it
+        m_render_graph->addPass(m_visualize_pass.get());
+        m_render_graph->setOutput(m_visualize_texture, m_is_visualization_enabled);
+
+        return m_render_graph->compile();
+    }
+
+    void Scene::render()
+    {
+        if (!m_is_initialized)
+            return;
+
+        // only blocks when the CPU is MAX_FRAMES_IN_FLIGHT frames ahead of the GPU
+        FrameContext& frame = *m_frame_contexts[m_frame_index];
+        if (!frame.begin())
+            return;
+
+        // the frame's region of the constant buffer is free again once the frame context retired
+        m_constant_buffer->beginFrame(m_frame_index);
+        if (!m_constant_buffer->write(m_global_constants, m_global_constants_offset))
+            return;
+
+        // one submission per queue switch, the queues wait on each other's timelines
+        m_render_graph->execute(frame);
+        m_frame_index = (m_frame_index + 1) % FrameContext::MAX_FRAMES_IN_FLIGHT;
+
+        // next frame's main pass projects with this frame's camera, the model matrix is assumed static between frames
+        m_global_constants.prev_translated_view_projection =
+            m_global_constants.projection_matrix * m_global_constants.view_matrix;
+        m_global_constants.prev_view_origin = m_global_constants.view_origin;
+        m_global_constants.misc0.y |= MISC0_PREV_HZB_VALID;
+    }
+
+    bool Scene::dumpVisualization(const char* path)
+    {
+        if (!m_is_initialized || !m_is_visualization_enabled)
+        {
+            ERROR("No visualization to dump.");
+            return false;
+        }
+
+        vkDeviceWaitIdle(RHI::instance().getDevice());
+
+        std::vector<glm::vec4> pixels(static_cast<size_t>(m_width) * m_height);
+        if (!m_visualize_texture->readbackData(pixels.data(), pixels.size() * sizeof(glm::vec4)))
+        {
+            ERROR("Failed to read back visualize texture.");
+            return false;
+        }
+
+        std::vector<uint8_t> rgb(pixels.size() * 3);
+        for (size_t i = 0; i < pixels.size(); ++i)
+        {
+            glm::vec3 color = glm::clamp(glm::vec3(pixels[i]), 0.0f, 1.0f) * 255.0f + 0.5f;
+            rgb[i * 3 + 0]  = static_cast<uint8_t>(color.r);
+            rgb[i * 3 + 1]  = static_cast<uint8_t>(color.g);
+            rgb[i * 3 + 2]  = static_cast<uint8_t>(color.b);
+        }
+
+        FILE* file = std::fopen(path, "wb");
+        if (file == nullptr)
+        {
+            ERROR("Failed to open file: %s", path);
+            return false;
+        }
+
+        std::fprintf(file, "P6\n%u %u\n255\n", m_width, m_height);
+        size_t written_size = std::fwrite(rgb.data(), 1, rgb.size(), file);
+        std::fclose(file);
+
+        if (written_size != rgb.size())
+        {
+            ERROR("Failed to write file: %s", path);
+            return false;
+        }
+
+        INFO("Dumped visualization to %s", path);
+        return true;
+    }
+
+    void Scene::setView(const glm::mat4& view,
+                        const glm::mat4& projection,
+                        float            near_plane,
+                        uint32_t         viewport_width,
+                        uint32_t         viewport_height)
+    {
+        glm::mat4 inv_view = glm::inverse(view);
+        glm::mat4 rotation = view;
+        rotation[3]        = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+        // culling happens relative to the camera, so the view matrix only keeps its rotation
+        m_global_constants.projection_matrix = projection;
+        m_global_constants.view_matrix       = rotation;
+        m_global_constants.view_origin       = glm::vec4(glm::vec3(inv_view[3]), m_global_constants.view_origin.w);
+        m_global_constants.view_forward =
+            glm::vec4(-glm::normalize(glm::vec3(inv_view[2])), m_global_constants.view_forward.w);
+        m_global_constants.view_params = glm::vec4(
+            near_plane, static_cast<float>(viewport_width), static_cast<float>(viewport_height), 0.0f);
+
+        m_projection_scale_y = std::abs(projection[1][1]);
+        updateLODScales();
+    }
+
+    void Scene::setModelMatrix(const glm::mat4& model) { m_global_constants.model_matrix = model; }
+
+    void Scene::setLODErrorThreshold(float pixels)
+    {
+        m_lod_error_threshold = std::max(pixels, 0.01f);
+        updateLODScales();
+    }
+
+    void Scene::setHWRasterEdgeThreshold(float pixels)
+    {
+        m_hw_raster_edge_threshold = std::max(pixels, 0.01f);
+        updateLODScales();
+    }
+
+    void Scene::setManualMipLevel(uint32_t mip_level) { m_global_constants.misc0.x = mip_level; }
+
+    void Scene::setVisualizationEnabled(bool is_enabled)
+    {
+        m_is_visualization_enabled = is_enabled;
+        if (m_render_graph)
+        {
+            m_render_graph->setOutput(m_visualize_texture, is_enabled);
+        }
+    }
+
+    void Scene::updateLODScales()
+    {
+        // world space error * lodScale / distance = error in pixels
+        float view_to_pixels = 0.5f * m_projection_scale_y * m_global_constants.view_params.z;
+
+        m_global_constants.view_origin.w  = view_to_pixels / m_lod_error_threshold;
+        m_global_constants.view_forward.w = view_to_pixels / m_hw_raster_edge_threshold;
+    }
 
     Scene g_scene;
-} // namespace Nano
\ No newline at end of file
+} // namespace Nano
@@ -1,23 +1,138 @@
 #ifndef SCENE_H
 #define SCENE_H
 
+#include <vulkan/vulkan_core.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "render/frame_context.h"
+
 namespace Nano
 {
+    class Buffer;
+    class DynamicBuffer;
+    class Texture;
+    class RenderPass;
+    class RenderGraph;
+
+    // Mirrors the std140 GlobalConstants block shared by the culling and raster shaders.
+    struct GlobalConstants
+    {
+        glm::mat4  projection_matrix {1.0f};
+        glm::mat4  view_matrix {1.0f}; // view rotation only, translation lives in view_origin
+        glm::mat4  model_matrix {1.0f};
+        glm::uvec4 misc0 {0xFFFFFFFFu, 0u, 0u, 0u}; // x: manual mip level, 0xFFFFFFFF => screen-space error LOD
+                                                    // y: bit 0 => last frame's HZB is valid
+        glm::vec4  view_origin {0.0f};              // xyz: camera position, w: lodScale
+        glm::vec4  view_forward {0.0f, 0.0f, -1.0f, 0.0f}; // xyz: camera forward, w: lodScaleHW (HW vs SW raster)
+        glm::vec4  view_params {0.0f};                     // x: near plane, y/z: viewport size
+        glm::mat4  prev_translated_view_projection {1.0f}; // last frame's projection * view, for the main pass HZB test
+        glm::vec4  prev_view_origin {0.0f};
+    };
+
     class Scene
     {
     public:
         Scene();
         ~Scene() noexcept;
 
-        Scene(Scene&&) noexcept            = default;
-        Scene& operator=(Scene&&) noexcept = default;
         Scene(const Scene&)                = delete;
         Scene& operator=(const Scene&)     = delete;
+        Scene(Scene&&) noexcept            = delete;
+        Scene& operator=(Scene&&) noexcept = delete;
+
+        bool initialize(uint32_t width, uint32_t height);
+        void render();
+        // g_scene outlives the RHI singleton, so GPU objects have to be released explicitly.
+        void cleanup();
+        // Waits for the GPU and writes the visualize output of the last frame as a binary PPM. Nothing renders after
+        // the visualize pass, so its transient memory still holds the image.
+        bool dumpVisualization(const char* path);
+
+        void setView(const glm::mat4& view,
+                     const glm::mat4& projection,
+                     float            near_plane,
+                     uint32_t         viewport_width,
+                     uint32_t         viewport_height);
+        void setModelMatrix(const glm::mat4& model);
+
+        // Max. screen-space error in pixels a cluster group may have before its children are selected.
+        void setLODErrorThreshold(float pixels);
+        // Clusters whose triangle edges project shorter than this many pixels are drawn by the compute rasterizer.
+        void setHWRasterEdgeThreshold(float pixels);
+        // Forces a fixed mip level, pass MANUAL_MIP_LEVEL_NONE to go back to screen-space error selection.
+        void setManualMipLevel(uint32_t mip_level);
+        // Without it the render graph culls the visualize pass, the frame still ends with the HZB.
+        void setVisualizationEnabled(bool is_enabled);
+
+        float                  getLODErrorThreshold() const { return m_lod_error_threshold; }
+        float                  getHWRasterEdgeThreshold() const { return m_hw_raster_edge_threshold; }
+        const GlobalConstants& getGlobalConstants() const { return m_global_constants; }
+        uint32_t               getHierarchyDepth() const { return m_hierarchy_depth; }
+
+        static constexpr uint32_t MANUAL_MIP_LEVEL_NONE {0xFFFFFFFFu};
+        static constexpr uint32_t MAX_CANDIDATE_NODES {1024};     // per culling pass
+        static constexpr uint32_t MAX_CANDIDATE_CLUSTERS {1u << 16}; // per culling pass
+        static constexpr uint32_t CONSTANT_BUFFER_FRAME_SIZE {64 * 1024};
 
     private:
+        bool createBuffers();
+        bool loadHierarchy(const char* path);
+        bool loadClusterPages(const char* path);
+        bool createPasses();
+        bool createRenderGraph();
+        bool buildPasses();
+        void addCullingPasses(uint32_t culling_pass);
+        void updateLODScales();
+
+        GlobalConstants m_global_constants;
+
+        float m_lod_error_threshold {1.0f};
+        float m_hw_raster_edge_threshold {32.0f};
+        float m_projection_scale_y {0.0f};
+
+        uint32_t m_width {0};
+        uint32_t m_height {0};
+        uint32_t m_hierarchy_depth {0};
+        bool     m_is_initialized {false};
+        bool     m_is_visualization_enabled {true};
+
+        std::unique_ptr<DynamicBuffer> m_constant_buffer;
+        uint32_t                       m_global_constants_offset {0}; // this frame's GlobalConstants in it
+        std::unique_ptr<Buffer>        m_bvh_buffer;
+        std::unique_ptr<Buffer>        m_cluster_page_data_buffer;
+        std::unique_ptr<Buffer>        m_echo_buffer;
+        std::unique_ptr<Buffer>        m_hzb;
+        std::unique_ptr<Buffer>        m_hzb_counter;
+
+        // transient, owned and aliased by the render graph
+        std::unique_ptr<RenderGraph> m_render_graph;
+        Buffer*                      m_main_and_post_node_and_cluster_batches {nullptr};
+        Buffer*                      m_work_args {nullptr}; // [level], see WorkArgs in NodeAndClusterCull.glsl
+        Buffer*                      m_cluster_work_args {nullptr};
+        Buffer*                      m_post_work_args {nullptr};
+        Buffer*                      m_post_cluster_work_args {nullptr};
+        Buffer*                      m_visible_clusters {nullptr};
+        Buffer*                      m_visible_cluster_draw_args {nullptr};
+        Buffer*                      m_vis_buffer64 {nullptr};
+        Texture*                     m_visualize_texture {nullptr};
+
+        std::unique_ptr<RenderPass> m_init_pass;             // culling work args, on the async compute queue
+        std::unique_ptr<RenderPass> m_init_vis_buffer_pass; // on graphics, the previous frame's tail reads VisBuffer64
+        // [main / post], sharing one pipeline and recorded once per level with the level pushed
+        std::unique_ptr<RenderPass> m_node_and_cluster_cull_passes[2];
+        std::unique_ptr<RenderPass> m_cluster_cull_passes[2];
+        std::unique_ptr<RenderPass> m_hw_rasterize_pass;
+        std::unique_ptr<RenderPass> m_sw_rasterize_passes[2]; // [main / post], dispatched from their ClusterWorkArgs
+        std::unique_ptr<RenderPass> m_hzb_build_pass;
+        std::unique_ptr<RenderPass> m_visualize_pass;
+
+        std::unique_ptr<FrameContext> m_frame_contexts[FrameContext::MAX_FRAMES_IN_FLIGHT];
+        uint32_t                      m_frame_index {0};
     };
 
     extern Scene g_scene;
 } // namespace Nano
 
-#endif // !SCENE_H
\ No newline at end of file
+#endif // !SCENE_H